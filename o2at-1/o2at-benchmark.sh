@@ -0,0 +1,108 @@
+#!/usr/bin/env bash
+# Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+# See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+# All rights not expressly granted are reserved.
+#
+# This software is distributed under the terms of the GNU General Public
+# License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+#
+# In applying this license CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization
+# or submit itself to any jurisdiction.
+#
+# Runs the tutorial tasks on a given AO2D file and reports, for each of them,
+# the wall time, the throughput (collisions/s and tracks/s) and the peak RSS.
+# Tasks that fail are reported as FAILED, see benchmark-<task>.log.
+#
+# Usage: ./o2at-benchmark.sh AO2D.root [task ...]
+#        (without task names, all the tasks below are run)
+#
+# To compare low- and high-multiplicity conditions, run it on AO2Ds of
+# different collision systems (e.g. pp and central Pb-Pb MC productions).
+# The names of the workflows depend on how the tutorial is built: adapt the
+# prefix and the helper workflows below to your O2Physics installation.
+
+set -u
+
+AO2D=${1:?"usage: $0 AO2D.root [task ...]"}
+shift
+
+PREFIX=${O2AT_PREFIX:-o2-analysistutorial-o2at}
+# reader and pipelining options to be tuned per site, e.g.
+# O2AT_READER_ARGS="--readers 2 --aod-memory-rate-limit 500000000"
+READER_ARGS=${O2AT_READER_ARGS:-}
+ARGS="-b --aod-file ${AO2D} --resources-monitoring 2 ${READER_ARGS}"
+
+# helper workflows providing the tables that are not in the AO2D
+DCA="o2-analysis-track-propagation ${ARGS}"
+EVSEL="o2-analysis-timestamp ${ARGS} | o2-analysis-event-selection ${ARGS}"
+PID="o2-analysis-pid-tpc ${ARGS}"
+V0S="${EVSEL} | ${DCA} | ${PID} | o2-analysis-lf-lambdakzerobuilder ${ARGS}"
+HF="${DCA} | o2-analysis-hf-track-index-skim-creator ${ARGS} | o2-analysis-hf-candidate-creator-2prong ${ARGS}"
+
+declare -A PIPELINES=(
+  [momentumexample]="${PREFIX}-momentumexample ${ARGS}"
+  [filterexample]="${DCA} | ${PREFIX}-filterexample ${ARGS}"
+  [partitionexample]="${DCA} | ${PREFIX}-partitionexample ${ARGS}"
+  [partandfiltexample]="${DCA} | ${PREFIX}-partandfiltexample ${ARGS}"
+  [partandfiltexample-singlepass]="${DCA} | ${PREFIX}-partandfiltexample ${ARGS} --singlePass"
+  [twoparcorexample]="${DCA} | ${PREFIX}-twoparcorexample ${ARGS}"
+  [twoparcorexample-engine]="${DCA} | ${PREFIX}-twoparcorexample ${ARGS} --twoparcorexample.usePairEngine 1"
+  [twoparcorexample-timeframe]="${DCA} | ${PREFIX}-twoparcorexample ${ARGS} --twoparcorexample.processPerCollision 0 --twoparcorexample.processTimeFrame 1"
+  [twoparcorcombexample]="${DCA} | ${PREFIX}-twoparcorcombexample ${ARGS}"
+  [twoparcorcombexample-engine]="${DCA} | ${PREFIX}-twoparcorcombexample ${ARGS} --twoparcorcombexample.usePairEngine 1"
+  [twoparcormixingexample]="${DCA} | ${PREFIX}-twoparcormixingexample ${ARGS}"
+  [v0pidexample]="${V0S} | ${PREFIX}-v0pidexample ${ARGS}"
+  # built with -DO2AT_PROFILING, the per-stage timers and counters are in the
+  # profiling/ histograms of its output
+  [v0templateexample]="${V0S} | ${PREFIX}-v0templateexample ${ARGS}"
+  [skimming]="${HF} | ${PREFIX}-skimming ${ARGS}"
+)
+
+# number of entries of a tree, summed over all the time frames of the file
+count_entries() {
+  root -l -b -q -e "
+    TFile f(\"${AO2D}\");
+    Long64_t n = 0;
+    for (auto key : *f.GetListOfKeys()) {
+      auto dir = dynamic_cast<TDirectory*>(f.Get(key->GetName()));
+      auto tree = dir ? dir->Get<TTree>(\"$1\") : nullptr;
+      n += tree ? tree->GetEntries() : 0;
+    }
+    std::cout << n << std::endl;" 2>/dev/null | tail -n 1
+}
+
+NCOLLISIONS=$(count_entries O2collision)
+NTRACKS=$(count_entries O2track_iu)
+FILE_MB=$(( $(stat -c %s "${AO2D}") / 1024 / 1024 ))
+echo "Input: ${AO2D} (file size ${FILE_MB} MB, ${NCOLLISIONS} collisions, ${NTRACKS} tracks)"
+
+TASKS=("$@")
+if [ ${#TASKS[@]} -eq 0 ]; then
+  TASKS=($(printf "%s\n" "${!PIPELINES[@]}" | sort))
+fi
+
+printf "%-36s %10s %14s %14s %14s\n" "task" "wall (s)" "collisions/s" "tracks/s" "peak RSS (MB)"
+for TASK in "${TASKS[@]}"; do
+  PIPELINE=${PIPELINES[${TASK}]:-}
+  if [ -z "${PIPELINE}" ]; then
+    echo "Unknown task ${TASK}" >&2
+    continue
+  fi
+  LOG="benchmark-${TASK}.log"
+  # wall time and maximum resident set size of the largest process of the workflow
+  /usr/bin/time -f "%e %M" -o "${LOG}.time" bash -c "${PIPELINE}" > "${LOG}" 2>&1
+  STATUS=$?
+  # per-device metrics (CPU, memory) are in performanceMetrics.json
+  mv -f performanceMetrics.json "benchmark-${TASK}-metrics.json" 2>/dev/null
+  if [ ${STATUS} -ne 0 ]; then
+    printf "%-36s %10s   (exit status %d, see %s)\n" "${TASK}" "FAILED" "${STATUS}" "${LOG}"
+    continue
+  fi
+  # the timing is on the last line (GNU time can add notes before it)
+  read -r WALL RSS < <(tail -n 1 "${LOG}.time")
+  printf "%-36s %10.1f %14.0f %14.0f %14.0f\n" "${TASK}" "${WALL}" \
+    "$(echo "${NCOLLISIONS} / ${WALL}" | bc -l)" \
+    "$(echo "${NTRACKS} / ${WALL}" | bc -l)" \
+    "$(echo "${RSS} / 1024" | bc -l)"
+done
@@ -0,0 +1,149 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \brief Periodic snapshots of the histograms of a task, to resume a job that
+///        was interrupted. Every "period" time frames, the bound histograms and
+///        the number of time frames processed so far are written to a file.
+///        A restarted job reading the same input loads the snapshot in init(),
+///        skips the time frames it contains and continues from there. Only the
+///        work of the task is skipped: the input is still read, and the tasks
+///        upstream still process the skipped time frames. A fingerprint of the
+///        time frames is saved too, and checked against the skipped ones.
+/// \author
+/// \since
+
+#ifndef O2AT_CHECKPOINT_H_
+#define O2AT_CHECKPOINT_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TParameter.h>
+
+namespace o2at
+{
+
+class Checkpoint
+{
+ public:
+  //Histograms to be saved, to be added before setup()
+  void add(std::shared_ptr<TH1> histogram) { mHistograms.push_back(histogram); }
+
+  //Enables the snapshots (an empty file name disables them) and, if a snapshot
+  //of a previous job exists, adds its content to the histograms
+  void setup(std::string const& fileName, int period)
+  {
+    mFileName = fileName;
+    mPeriod = period;
+    if (mFileName.empty()) {
+      return;
+    }
+    std::unique_ptr<TFile> lFile{TFile::Open(mFileName.c_str(), "READ")};
+    if (!lFile || lFile->IsZombie()) {
+      return; //<- first job, nothing to resume
+    }
+    auto lProcessed = lFile->Get<TParameter<Long64_t>>("processedTimeFrames");
+    auto lFingerprint = lFile->Get<TParameter<Long64_t>>("inputFingerprint");
+    if (!lProcessed || !lFingerprint) {
+      return;
+    }
+    for (auto& histogram : mHistograms) {
+      if (auto lSaved = lFile->Get<TH1>(histogram->GetName())) {
+        histogram->Add(lSaved);
+      }
+    }
+    mToSkip = lProcessed->GetVal();
+    mSavedFingerprint = static_cast<uint64_t>(lFingerprint->GetVal());
+  }
+
+  //To be called at the beginning of each time frame, with a key identifying it
+  //(e.g. its number of rows): true if the time frame is already contained in
+  //the resumed snapshot
+  bool skipTimeFrame(uint64_t key)
+  {
+    mFingerprint = (mFingerprint ^ key) * 0x100000001b3ull; //<- FNV-1a step, depends on the order
+    if (mToSkip > 0) {
+      mToSkip--;
+      mProcessed++;
+      if (mToSkip == 0) {
+        mInputChanged = mFingerprint != mSavedFingerprint;
+      }
+      return true;
+    }
+    return false;
+  }
+
+  //True if the time frames skipped on resume are not those of the snapshot:
+  //the input differs from the one of the interrupted job
+  bool inputChanged() const { return mInputChanged; }
+
+  //To be called at the end of each processed time frame
+  void endTimeFrame()
+  {
+    mProcessed++;
+    if (!mFileName.empty() && mPeriod > 0 && mProcessed % mPeriod == 0) {
+      write();
+    }
+  }
+
+  //To be called at the end of the stream: the job is complete and its snapshot
+  //is removed, so that the next job on this file starts from scratch
+  void endOfStream()
+  {
+    if (mToSkip > 0) {
+      mInputChanged = true; //<- fewer time frames than in the snapshot
+      return;
+    }
+    if (!mFileName.empty()) {
+      std::remove(mFileName.c_str());
+    }
+  }
+
+ private:
+  //Writes to a temporary file, renamed at the end: a job killed while writing
+  //leaves the previous snapshot untouched
+  void write() const
+  {
+    const std::string lTemporary = mFileName + ".tmp";
+    {
+      std::unique_ptr<TFile> lFile{TFile::Open(lTemporary.c_str(), "RECREATE")};
+      if (!lFile || lFile->IsZombie()) {
+        return;
+      }
+      for (auto& histogram : mHistograms) {
+        lFile->WriteTObject(histogram.get(), histogram->GetName());
+      }
+      TParameter<Long64_t> lProcessed("processedTimeFrames", mProcessed);
+      lFile->WriteTObject(&lProcessed);
+      TParameter<Long64_t> lFingerprint("inputFingerprint", static_cast<Long64_t>(mFingerprint));
+      lFile->WriteTObject(&lFingerprint);
+    }
+    std::rename(lTemporary.c_str(), mFileName.c_str());
+  }
+
+  std::vector<std::shared_ptr<TH1>> mHistograms;
+  std::string mFileName;
+  int mPeriod = 0;
+  Long64_t mProcessed = 0;
+  Long64_t mToSkip = 0;
+  uint64_t mFingerprint = 0xcbf29ce484222325ull;
+  uint64_t mSavedFingerprint = 0;
+  bool mInputChanged = false;
+};
+
+} // namespace o2at
+
+#endif // O2AT_CHECKPOINT_H_
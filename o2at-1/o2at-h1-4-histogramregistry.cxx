@@ -18,6 +18,7 @@
 
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -43,12 +44,25 @@ struct histogramregistry {
     }
   };
 
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramFill;
+  o2at::StagedFill1D ptHistogramFill;
+
+  void init(InitContext const&)
+  {
+    etaHistogramFill.bind(registry.get<TH1>(HIST("etaHistogram")));
+    ptHistogramFill.bind(registry.get<TH1>(HIST("ptHistogram")));
+  }
+
   void process(aod::TracksIU const& tracks)
   {
     for (auto& track : tracks) {
-      registry.get<TH1>(HIST("etaHistogram"))->Fill(track.eta());
-      registry.get<TH1>(HIST("ptHistogram"))->Fill(track.pt());
+      etaHistogramFill.push(track.eta());
+      ptHistogramFill.push(track.pt());
     }
+    //Push the staged values to the histograms once per call
+    etaHistogramFill.flush();
+    ptHistogramFill.flush();
   }
 };
 
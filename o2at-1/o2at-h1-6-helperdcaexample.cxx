@@ -19,6 +19,7 @@
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -42,6 +43,16 @@ struct helperdcaexample {
     }
   };
 
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramFill;
+  o2at::StagedFill1D ptHistogramFill;
+
+  void init(InitContext const&)
+  {
+    etaHistogramFill.bind(registry.get<TH1>(HIST("etaHistogram")));
+    ptHistogramFill.bind(registry.get<TH1>(HIST("ptHistogram")));
+  }
+
   void process(aod::Collision const& collision, soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA> const& tracks) //<- this is the main change
   {
     //Fill the event counter
@@ -51,9 +62,12 @@ struct helperdcaexample {
     for (auto& track : tracks) {
       if( track.tpcNClsCrossedRows() < 70 ) continue; //skip stuff not tracked well by TPC
       if( fabs(track.dcaXY()) > .2 ) continue; //skip stuff that doesn't point to PV (example, can be elaborate!)
-      registry.get<TH1>(HIST("etaHistogram"))->Fill(track.eta());
-      registry.get<TH1>(HIST("ptHistogram"))->Fill(track.pt());
+      etaHistogramFill.push(track.eta());
+      ptHistogramFill.push(track.pt());
     }
+    //Push the staged values to the histograms once per call
+    etaHistogramFill.flush();
+    ptHistogramFill.flush();
   }
 };
 
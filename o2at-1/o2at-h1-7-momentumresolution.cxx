@@ -19,10 +19,20 @@
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-stagedfill.h"
+#include "o2at-mcgather.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
 
 using namespace o2;
 using namespace o2::framework;
 
+using MyTracksMC = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA, aod::McTrackLabels>;
+
 //STEP 7
 //This more sophisticated example exemplifies the access of MC information
 //to calculate a simple transverse momentum resolution histogram.
@@ -36,6 +46,11 @@ struct momentumresolution {
   //Configurable for number of bins
   Configurable<int> nBinsEta{"nBinsEta", 100, "N bins in eta histo"};
   Configurable<int> nBinsPt{"nBinsPt", 100, "N bins in pT histo"};
+  //Configurables for the (opt-in) multithreaded processing
+  Configurable<int> nThreads{"nThreads", 4, "Number of worker threads in processThreaded"};
+  Configurable<int> chunkSize{"chunkSize", 16, "Number of collisions claimed at once by a worker in processThreaded"};
+  //Configurable for the (opt-in) multi-differential resolution
+  Configurable<bool> doSparseReso{"doSparseReso", false, "Fill the resolution vs pT, eta and vertex-z in processSerial"};
   
   // histogram defined with HistogramRegistry
   HistogramRegistry registry{
@@ -48,26 +63,175 @@ struct momentumresolution {
     }
   };
 
-  void process(aod::Collision const& collision, soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA, aod::McTrackLabels> const& tracks, aod::McParticles const&) //<- this is the main change
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramFill;
+  o2at::StagedFill1D ptHistogramFill;
+  o2at::StagedFill2D resoHistogramFill;
+  //Selected tracks with an MC label, resolved once per collision
+  o2at::McPtGather mcGather;
+  std::vector<float> mcGatherEta; //<- eta of the same tracks, for the multi-differential resolution
+
+  //Private copies of the histograms, one set per worker thread
+  struct HistogramShard {
+    std::unique_ptr<TH1> etaHistogram;
+    std::unique_ptr<TH1> ptHistogram;
+    std::unique_ptr<TH2> resoHistogram;
+    o2at::McPtGather mcGather;
+  };
+  std::vector<HistogramShard> shards;
+
+  //Per-collision slice index of the tracks: [sliceBegin, sliceEnd) for each
+  //collision, built once per time frame in a single pass over the tracks
+  std::vector<uint64_t> sliceBegin;
+  std::vector<uint64_t> sliceEnd;
+
+  template <typename TTracks>
+  void buildSliceIndex(uint64_t nCollisions, TTracks const& tracks)
+  {
+    sliceBegin.assign(nCollisions, 0);
+    sliceEnd.assign(nCollisions, 0);
+    uint64_t iTrack = 0;
+    for (auto& track : tracks) {
+      auto lCollision = track.collisionId();
+      if (lCollision >= 0) { //<- tracks are sorted by collision index, unassigned ones are skipped
+        if (sliceEnd[lCollision] == 0) {
+          sliceBegin[lCollision] = iTrack;
+        }
+        sliceEnd[lCollision] = iTrack + 1;
+      }
+      iTrack++;
+    }
+  }
+
+  template <typename T>
+  static std::unique_ptr<T> makeShard(std::shared_ptr<T> const& histogram)
+  {
+    std::unique_ptr<T> lShard{static_cast<T*>(histogram->Clone())};
+    lShard->SetDirectory(nullptr);
+    lShard->Reset();
+    return lShard;
+  }
+
+  void init(InitContext const&)
+  {
+    //Multi-differential histograms are booked sparse: only the bins that are
+    //actually filled take memory, and the output is merged without densifying it
+    if (doSparseReso) {
+      registry.add("resoSparse", "resoSparse", {HistType::kTHnSparseF, {{nBinsPt, 0., 10.0, "#it{p}_{T} (GeV/#it{c})"}, {100, -10.0, 10.0, "#Delta#it{p}_{T} (GeV/#it{c})"}, {nBinsEta, -1., +1, "#eta"}, {30, -15., 15., "vertex-z (cm)"}}});
+    }
+    etaHistogramFill.bind(registry.get<TH1>(HIST("etaHistogram")));
+    ptHistogramFill.bind(registry.get<TH1>(HIST("ptHistogram")));
+    resoHistogramFill.bind(registry.get<TH2>(HIST("resoHistogram")));
+
+    if (doprocessThreaded) {
+      shards.resize(std::max(1, nThreads.value));
+      for (auto& shard : shards) {
+        shard.etaHistogram = makeShard(registry.get<TH1>(HIST("etaHistogram")));
+        shard.ptHistogram = makeShard(registry.get<TH1>(HIST("ptHistogram")));
+        shard.resoHistogram = makeShard(registry.get<TH2>(HIST("resoHistogram")));
+      }
+    }
+  }
+
+  void processSerial(aod::Collision const& collision, MyTracksMC const& tracks, aod::McParticles const& mcParticles) //<- this is the main change
   {
     //Fill the event counter
     //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
     //This will take place once per event!
+    mcGather.clear();
+    mcGatherEta.clear();
     for (auto& track : tracks) {
       if( track.tpcNClsCrossedRows() < 70 ) continue; //skip stuff not tracked well by TPC
       if( fabs(track.dcaXY()) > .2 ) continue; //skip stuff that doesn't point to PV (example, can be elaborate!)
-      registry.get<TH1>(HIST("etaHistogram"))->Fill(track.eta());
-      registry.get<TH1>(HIST("ptHistogram"))->Fill(track.pt());
-      
-      //Resolve MC track - no need to touch index!
-      auto mcParticle = track.mcParticle_as<aod::McParticles>();
+      etaHistogramFill.push(track.eta());
+      ptHistogramFill.push(track.pt());
       
+      //Keep the MC label only: the MC particles are resolved after the loop
+      if( !track.has_mcParticle() ) continue; //<- fake or unlabelled track
+      mcGather.push(track.pt(), track.mcParticleId());
+      mcGatherEta.push_back(track.eta());
+    }
+    //Resolve the MC particles of the selected tracks in one ordered pass
+    mcGather.gather(mcParticles);
+    for (size_t i = 0; i < mcGather.size(); i++) {
       //Very rough momentum resolution
-      float delta = track.pt() - mcParticle.pt();
-      registry.get<TH2>(HIST("resoHistogram"))->Fill(track.pt(), delta);
+      float delta = mcGather.recoPt(i) - mcGather.mcPt(i);
+      resoHistogramFill.push(mcGather.recoPt(i), delta);
+      if (doSparseReso) {
+        registry.fill(HIST("resoSparse"), mcGather.recoPt(i), delta, mcGatherEta[i], collision.posZ());
+      }
+    }
+    //Push the staged values to the histograms once per call
+    etaHistogramFill.flush();
+    ptHistogramFill.flush();
+    resoHistogramFill.flush();
+  }
+  PROCESS_SWITCH(momentumresolution, processSerial, "Process one collision at a time", true);
+
+  //Alternative process function: the whole time frame is received at once and
+  //the collisions are shared between worker threads. Workers claim chunks of
+  //collisions from a common counter (so that fast workers take over the remaining
+  //work), access their tracks through the slice index, and fill their private
+  //histogram shards, which are merged into the registry at the end of the call.
+  //The input tables are never copied.
+  void processThreaded(aod::Collisions const& collisions, MyTracksMC const& tracks, aod::McParticles const& mcParticles)
+  {
+    for (auto& collision : collisions) {
+      registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+    }
+
+    const uint64_t nCollisions = collisions.size();
+    buildSliceIndex(nCollisions, tracks);
+
+    const uint64_t lChunkSize = std::max(1, chunkSize.value);
+    std::atomic<uint64_t> nextCollision{0};
+    auto worker = [&](HistogramShard& shard) {
+      for (uint64_t begin = nextCollision.fetch_add(lChunkSize); begin < nCollisions; begin = nextCollision.fetch_add(lChunkSize)) {
+        const uint64_t end = std::min(begin + lChunkSize, nCollisions);
+        for (uint64_t iCollision = begin; iCollision < end; iCollision++) {
+          if (sliceBegin[iCollision] == sliceEnd[iCollision]) {
+            continue;
+          }
+          shard.mcGather.clear();
+          auto track = tracks.rawIteratorAt(sliceBegin[iCollision]);
+          for (uint64_t iTrack = sliceBegin[iCollision]; iTrack < sliceEnd[iCollision]; iTrack++, ++track) {
+            if( track.tpcNClsCrossedRows() < 70 ) continue;
+            if( fabs(track.dcaXY()) > .2 ) continue;
+            shard.etaHistogram->Fill(track.eta());
+            shard.ptHistogram->Fill(track.pt());
+            if( !track.has_mcParticle() ) continue;
+            shard.mcGather.push(track.pt(), track.mcParticleId());
+          }
+          shard.mcGather.gather(mcParticles);
+          for (size_t i = 0; i < shard.mcGather.size(); i++) {
+            float delta = shard.mcGather.recoPt(i) - shard.mcGather.mcPt(i);
+            shard.resoHistogram->Fill(shard.mcGather.recoPt(i), delta);
+          }
+        }
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t iShard = 1; iShard < shards.size(); iShard++) {
+      workers.emplace_back(worker, std::ref(shards[iShard]));
+    }
+    worker(shards[0]); //<- the calling thread works too
+    for (auto& thread : workers) {
+      thread.join();
+    }
+
+    //Merge the shards into the output and get them ready for the next call
+    for (auto& shard : shards) {
+      registry.get<TH1>(HIST("etaHistogram"))->Add(shard.etaHistogram.get());
+      registry.get<TH1>(HIST("ptHistogram"))->Add(shard.ptHistogram.get());
+      registry.get<TH2>(HIST("resoHistogram"))->Add(shard.resoHistogram.get());
+      shard.etaHistogram->Reset();
+      shard.ptHistogram->Reset();
+      shard.resoHistogram->Reset();
     }
   }
+  PROCESS_SWITCH(momentumresolution, processThreaded, "Process the whole time frame with several threads", false);
 };
 
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
@@ -18,6 +18,7 @@
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -45,6 +46,16 @@ struct startingpoint {
     }
   };
 
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramFill;
+  o2at::StagedFill1D ptHistogramFill;
+
+  void init(InitContext const&)
+  {
+    etaHistogramFill.bind(registry.get<TH1>(HIST("etaHistogram")));
+    ptHistogramFill.bind(registry.get<TH1>(HIST("ptHistogram")));
+  }
+
   void process(aod::Collision const& collision, MyCompleteTracks const& tracks) //<- this is the main change
   {
     //Fill the event counter
@@ -56,9 +67,12 @@ struct startingpoint {
       if( fabs(track.eta()) > 0.5 ) continue;
       if( track.tpcNClsCrossedRows() < 70 ) continue;
       if( fabs(track.dcaXY()) > .2 ) continue;
-      registry.get<TH1>(HIST("etaHistogram"))->Fill(track.eta());
-      registry.get<TH1>(HIST("ptHistogram"))->Fill(track.pt());
+      etaHistogramFill.push(track.eta());
+      ptHistogramFill.push(track.pt());
     }
+    //Push the staged values to the histograms once per call
+    etaHistogramFill.flush();
+    ptHistogramFill.flush();
   }
 };
 
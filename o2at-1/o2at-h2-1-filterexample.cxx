@@ -18,6 +18,7 @@
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -34,10 +35,12 @@ using MyCompleteTracks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA
 //Therefore, one has to write the expression to filter on by hand
 //When necessary, check the data model online:
 // https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
+//N.B.: the literals have the type of their column (float literals for float
+//columns): a double literal such as .2 would add a cast for every row.
 struct filterexample {
   Filter etaFilter = nabs(aod::track::eta) < 0.5f;
   Filter trackQuality = aod::track::tpcNClsFindable - aod::track::tpcNClsFindableMinusCrossedRows >= 70;
-  Filter trackDCA = nabs(aod::track::dcaXY) <= .2;
+  Filter trackDCA = nabs(aod::track::dcaXY) <= .2f;
 
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
@@ -52,6 +55,16 @@ struct filterexample {
     }
   };
 
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramFill;
+  o2at::StagedFill1D ptHistogramFill;
+
+  void init(InitContext const&)
+  {
+    etaHistogramFill.bind(registry.get<TH1>(HIST("etaHistogram")));
+    ptHistogramFill.bind(registry.get<TH1>(HIST("ptHistogram")));
+  }
+
   void process(aod::Collision const& collision, soa::Filtered<MyCompleteTracks> const& tracks) //<- this is the main change
   {
     //Fill the event counter
@@ -59,9 +72,12 @@ struct filterexample {
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
     //This will take place once per event!
     for (auto& track : tracks) {
-      registry.get<TH1>(HIST("etaHistogram"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogram"))->Fill(track.pt());
+      etaHistogramFill.push(track.eta()); //<- this should show the selection
+      ptHistogramFill.push(track.pt());
     }
+    //Push the staged values to the histograms once per call
+    etaHistogramFill.flush();
+    ptHistogramFill.flush();
   }
 };
 
@@ -18,6 +18,7 @@
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -32,8 +33,8 @@ using MyCompleteTracks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA
 //but the usage of a specific partition inside the process function can now be used.
 //This is all pretty similar to PYTHON list handling.
 struct partitionexample {
-  Partition<o2::aod::Tracks> leftTracks = aod::track::eta < 0;
-  Partition<o2::aod::Tracks> rightTracks = aod::track::eta >= 0;
+  Partition<o2::aod::Tracks> leftTracks = aod::track::eta < 0.f;
+  Partition<o2::aod::Tracks> rightTracks = aod::track::eta >= 0.f;
 
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
@@ -51,6 +52,20 @@ struct partitionexample {
     }
   };
 
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramleftFill;
+  o2at::StagedFill1D ptHistogramleftFill;
+  o2at::StagedFill1D etaHistogramrightFill;
+  o2at::StagedFill1D ptHistogramrightFill;
+
+  void init(InitContext const&)
+  {
+    etaHistogramleftFill.bind(registry.get<TH1>(HIST("etaHistogramleft")));
+    ptHistogramleftFill.bind(registry.get<TH1>(HIST("ptHistogramleft")));
+    etaHistogramrightFill.bind(registry.get<TH1>(HIST("etaHistogramright")));
+    ptHistogramrightFill.bind(registry.get<TH1>(HIST("ptHistogramright")));
+  }
+
   void process(aod::Collision const& collision, /*soa::Filtered<*/MyCompleteTracks/*>*/ const& tracks)
   {
     //Fill the event counter
@@ -58,13 +73,18 @@ struct partitionexample {
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
     //This will take place once per event!
     for (auto track : leftTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramleft"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramleft"))->Fill(track.pt());
+      etaHistogramleftFill.push(track.eta()); //<- this should show the selection
+      ptHistogramleftFill.push(track.pt());
     }
     for (auto track : rightTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramright"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramright"))->Fill(track.pt());
+      etaHistogramrightFill.push(track.eta()); //<- this should show the selection
+      ptHistogramrightFill.push(track.pt());
     }
+    //Push the staged values to the histograms once per call
+    etaHistogramleftFill.flush();
+    ptHistogramleftFill.flush();
+    etaHistogramrightFill.flush();
+    ptHistogramrightFill.flush();
   }
 };
 
@@ -15,14 +15,24 @@
 /// \author
 /// \since
 
-#include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
 
+//Opt-in variant of the example, see partandfiltsinglepass below: it is chosen
+//when the workflow is built, hence customize() is defined before including
+//runDataProcessing.h
+void customize(std::vector<ConfigParamSpec>& workflowOptions)
+{
+  workflowOptions.push_back(ConfigParamSpec{"singlePass", VariantType::Bool, false, {"Split the tracks in one pass instead of two Partitions"}});
+}
+
+#include "Framework/runDataProcessing.h"
+
 //This is an example of a conveient declaration of "using"
 using MyCompleteTracks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA>;
 
@@ -31,11 +41,11 @@ using MyCompleteTracks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA
 //In practice, the partitions act on top of the already filtered data.
 //This example also provides specific histograms to inspect the outcome.
 struct partandfiltexample {
-  Partition<o2::aod::Tracks> leftTracks = aod::track::eta < 0;
-  Partition<o2::aod::Tracks> rightTracks = aod::track::eta >= 0;
+  Partition<o2::aod::Tracks> leftTracks = aod::track::eta < 0.f;
+  Partition<o2::aod::Tracks> rightTracks = aod::track::eta >= 0.f;
   Filter etaFilter = nabs(aod::track::eta) < 0.5f;
   Filter trackQuality = aod::track::tpcNClsFindable - aod::track::tpcNClsFindableMinusCrossedRows >= 70;
-  Filter trackDCA = nabs(aod::track::dcaXY) <= .2;
+  Filter trackDCA = nabs(aod::track::dcaXY) <= .2f;
 
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
@@ -53,6 +63,20 @@ struct partandfiltexample {
     }
   };
 
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramleftFill;
+  o2at::StagedFill1D ptHistogramleftFill;
+  o2at::StagedFill1D etaHistogramrightFill;
+  o2at::StagedFill1D ptHistogramrightFill;
+
+  void init(InitContext const&)
+  {
+    etaHistogramleftFill.bind(registry.get<TH1>(HIST("etaHistogramleft")));
+    ptHistogramleftFill.bind(registry.get<TH1>(HIST("ptHistogramleft")));
+    etaHistogramrightFill.bind(registry.get<TH1>(HIST("etaHistogramright")));
+    ptHistogramrightFill.bind(registry.get<TH1>(HIST("ptHistogramright")));
+  }
+
   void process(aod::Collision const& collision, soa::Filtered<MyCompleteTracks> const& tracks)
   {
     //Fill the event counter
@@ -60,19 +84,92 @@ struct partandfiltexample {
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
     //This will take place once per event!
     for (auto track : leftTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramleft"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramleft"))->Fill(track.pt());
+      etaHistogramleftFill.push(track.eta()); //<- this should show the selection
+      ptHistogramleftFill.push(track.pt());
     }
     for (auto track : rightTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramright"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramright"))->Fill(track.pt());
+      etaHistogramrightFill.push(track.eta()); //<- this should show the selection
+      ptHistogramrightFill.push(track.pt());
+    }
+    //Push the staged values to the histograms once per call
+    etaHistogramleftFill.flush();
+    ptHistogramleftFill.flush();
+    etaHistogramrightFill.flush();
+    ptHistogramrightFill.flush();
+  }
+};
+
+//Opt-in variant of STEP 3 (workflow option --singlePass): the two partitions
+//above are complementary, so instead of evaluating two Partitions, each
+//filtered track is put in its bucket in a single pass over the selection.
+//The Partitions are not declared at all, since they would be evaluated anyway.
+//Same histograms and same task name, so the two can be compared directly.
+struct partandfiltsinglepass {
+  Filter etaFilter = nabs(aod::track::eta) < 0.5f;
+  Filter trackQuality = aod::track::tpcNClsFindable - aod::track::tpcNClsFindableMinusCrossedRows >= 70;
+  Filter trackDCA = nabs(aod::track::dcaXY) <= .2f;
+
+  //Configurable for number of bins
+  Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
+
+  // histogram defined with HistogramRegistry
+  HistogramRegistry registry{
+    "registry",
+    {
+      {"hVertexZ", "hVertexZ", {HistType::kTH1F, {{nBins, -15., 15.}}}},
+      {"etaHistogramleft", "etaHistogramleft", {HistType::kTH1F, {{nBins, -1., +1}}}},
+      {"ptHistogramleft", "ptHistogramleft", {HistType::kTH1F, {{nBins, 0., 10.0}}}},
+      {"etaHistogramright", "etaHistogramright", {HistType::kTH1F, {{nBins, -1., +1}}}},
+      {"ptHistogramright", "ptHistogramright", {HistType::kTH1F, {{nBins, 0., 10.0}}}}
+      
+    }
+  };
+
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramleftFill;
+  o2at::StagedFill1D ptHistogramleftFill;
+  o2at::StagedFill1D etaHistogramrightFill;
+  o2at::StagedFill1D ptHistogramrightFill;
+
+  void init(InitContext const&)
+  {
+    etaHistogramleftFill.bind(registry.get<TH1>(HIST("etaHistogramleft")));
+    ptHistogramleftFill.bind(registry.get<TH1>(HIST("ptHistogramleft")));
+    etaHistogramrightFill.bind(registry.get<TH1>(HIST("etaHistogramright")));
+    ptHistogramrightFill.bind(registry.get<TH1>(HIST("ptHistogramright")));
+  }
+
+  void process(aod::Collision const& collision, soa::Filtered<MyCompleteTracks> const& tracks)
+  {
+    //Fill the event counter
+    //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
+    registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+    //This will take place once per event!
+    for (auto& track : tracks) {
+      if (track.eta() < 0) { //<- left bucket
+        etaHistogramleftFill.push(track.eta()); //<- this should show the selection
+        ptHistogramleftFill.push(track.pt());
+      } else { //<- right bucket
+        etaHistogramrightFill.push(track.eta());
+        ptHistogramrightFill.push(track.pt());
+      }
     }
+    //Push the staged values to the histograms once per call
+    etaHistogramleftFill.flush();
+    ptHistogramleftFill.flush();
+    etaHistogramrightFill.flush();
+    ptHistogramrightFill.flush();
   }
 };
 
 
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
 {
+  if (cfgc.options().get<bool>("singlePass")) {
+    return WorkflowSpec{
+      adaptAnalysisTask<partandfiltsinglepass>(cfgc, TaskName{"partandfiltexample"})
+    };
+  }
   return WorkflowSpec{
     adaptAnalysisTask<partandfiltexample>(cfgc)
   };
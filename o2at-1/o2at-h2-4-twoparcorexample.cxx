@@ -18,6 +18,8 @@
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-pairengine.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -32,13 +34,16 @@ using MyCompleteTracks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA
 //The core part of the 2pc filling utilises two for loops.
 struct twoparcorexample {
   //Fully declarative!
-  Partition<o2::aod::Tracks> triggerTracks = aod::track::pt > 2;
-  Partition<o2::aod::Tracks> assocTracks = aod::track::pt < 2;
+  Partition<o2::aod::Tracks> triggerTracks = aod::track::pt > 2.f;
+  Partition<o2::aod::Tracks> assocTracks = aod::track::pt < 2.f;
   Filter etaFilter = nabs(aod::track::eta) < 0.5f;
   Filter trackQuality = aod::track::tpcNClsFindable - aod::track::tpcNClsFindableMinusCrossedRows >= 70;
-  Filter trackDCA = nabs(aod::track::dcaXY) <= .2;
+  Filter trackDCA = nabs(aod::track::dcaXY) <= .2f;
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
+  //Opt-in pair engine (o2at-pairengine.h): faster at high multiplicity, but it
+  //replaces the two for loops below, which are the subject of this step
+  Configurable<bool> usePairEngine{"usePairEngine", false, "Fill correlationFunction with the cached-buffer pair engine"};
   // histogram defined with HistogramRegistry
   HistogramRegistry registry{
     "registry",
@@ -52,7 +57,27 @@ struct twoparcorexample {
       
     }
   };
+
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramTriggerFill;
+  o2at::StagedFill1D ptHistogramTriggerFill;
+  o2at::StagedFill1D etaHistogramAssocFill;
+  o2at::StagedFill1D ptHistogramAssocFill;
   
+  //Per-collision buffers for the pair engine (kept as members to reuse memory)
+  o2at::PairTrackBuffer triggerBuffer;
+  o2at::PairTrackBuffer assocBuffer;
+  o2at::PairEngine pairEngine;
+
+  void init(InitContext const&)
+  {
+    etaHistogramTriggerFill.bind(registry.get<TH1>(HIST("etaHistogramTrigger")));
+    ptHistogramTriggerFill.bind(registry.get<TH1>(HIST("ptHistogramTrigger")));
+    etaHistogramAssocFill.bind(registry.get<TH1>(HIST("etaHistogramAssoc")));
+    ptHistogramAssocFill.bind(registry.get<TH1>(HIST("ptHistogramAssoc")));
+    pairEngine.bind(registry.get<TH2>(HIST("correlationFunction")));
+  }
+
   Double_t ComputeDeltaPhi( Double_t phi1, Double_t phi2) {
       //To be completely sure, use inner products
       Double_t x1, y1, x2, y2;
@@ -78,21 +103,52 @@ struct twoparcorexample {
       return lReturnVal;
   }
 
-  void process(aod::Collision const& collision, soa::Filtered<MyCompleteTracks> const& tracks) //<- this is the main change
+  //Push the staged values to the histograms once per call
+  void flushInspectionHistograms()
+  {
+    etaHistogramTriggerFill.flush();
+    ptHistogramTriggerFill.flush();
+    etaHistogramAssocFill.flush();
+    ptHistogramAssocFill.flush();
+  }
+
+  void processPerCollision(aod::Collision const& collision, soa::Filtered<MyCompleteTracks> const& tracks) //<- this is the main change
   {
     //Fill the event counter
     //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+
+    //Pair engine: eta and phi of the tracks of the two partitions are cached
+    //once per track, and then all pairs are binned in one go
+    if (usePairEngine) {
+      triggerBuffer.clear();
+      assocBuffer.clear();
+      for (auto& track : triggerTracks) {
+        etaHistogramTriggerFill.push(track.eta());
+        ptHistogramTriggerFill.push(track.pt());
+        triggerBuffer.push(track.eta(), track.phi());
+      }
+      for (auto& track : assocTracks) {
+        etaHistogramAssocFill.push(track.eta());
+        ptHistogramAssocFill.push(track.pt());
+        assocBuffer.push(track.eta(), track.phi());
+      }
+      flushInspectionHistograms();
+      pairEngine.fill(triggerBuffer, assocBuffer);
+      pairEngine.flush();
+      return;
+    }
     
     //Inspect the trigger and associated populations
     for (auto track : triggerTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramTrigger"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramTrigger"))->Fill(track.pt());
+      etaHistogramTriggerFill.push(track.eta()); //<- this should show the selection
+      ptHistogramTriggerFill.push(track.pt());
     }
     for (auto track : assocTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramAssoc"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramAssoc"))->Fill(track.pt());
+      etaHistogramAssocFill.push(track.eta()); //<- this should show the selection
+      ptHistogramAssocFill.push(track.pt());
     }
+    flushInspectionHistograms();
     
     //Now we do two-particle correlations, but still manually
     for (auto trackTrigger : triggerTracks) { //<- only for trigger
@@ -103,6 +159,51 @@ struct twoparcorexample {
       }
     }
   }
+  PROCESS_SWITCH(twoparcorexample, processPerCollision, "Process one collision at a time", true);
+
+  //Alternative process function, for high multiplicities: the whole time frame
+  //is received at once, and the partitions then contain the trigger and
+  //associated tracks of all its collisions, still sorted by collision index. The
+  //two are walked together, one collision at a time, the pairs of all the
+  //collisions are accumulated by the pair engine, and the histograms are updated
+  //once per time frame instead of once per collision
+  void processTimeFrame(aod::Collisions const& collisions, soa::Filtered<MyCompleteTracks> const& tracks) //<- the partitions are taken from these tracks
+  {
+    for (auto& collision : collisions) {
+      registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+    }
+
+    auto lTrigger = triggerTracks.begin();
+    auto lAssoc = assocTracks.begin();
+    while (lTrigger != triggerTracks.end() || lAssoc != assocTracks.end()) {
+      //next collision with tracks in either partition
+      int64_t lCollision = lTrigger != triggerTracks.end() ? lTrigger.collisionId() : lAssoc.collisionId();
+      if (lAssoc != assocTracks.end() && lAssoc.collisionId() < lCollision) {
+        lCollision = lAssoc.collisionId();
+      }
+      const bool lAssigned = lCollision >= 0; //<- unassigned tracks are skipped, as in the grouped case
+      triggerBuffer.clear();
+      assocBuffer.clear();
+      for (; lTrigger != triggerTracks.end() && lTrigger.collisionId() == lCollision; ++lTrigger) {
+        if (lAssigned) {
+          etaHistogramTriggerFill.push(lTrigger.eta());
+          ptHistogramTriggerFill.push(lTrigger.pt());
+          triggerBuffer.push(lTrigger.eta(), lTrigger.phi());
+        }
+      }
+      for (; lAssoc != assocTracks.end() && lAssoc.collisionId() == lCollision; ++lAssoc) {
+        if (lAssigned) {
+          etaHistogramAssocFill.push(lAssoc.eta());
+          ptHistogramAssocFill.push(lAssoc.pt());
+          assocBuffer.push(lAssoc.eta(), lAssoc.phi());
+        }
+      }
+      pairEngine.fill(triggerBuffer, assocBuffer);
+    }
+    flushInspectionHistograms();
+    pairEngine.flush();
+  }
+  PROCESS_SWITCH(twoparcorexample, processTimeFrame, "Process the whole time frame, with one histogram update", false);
 };
 
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
@@ -18,6 +18,8 @@
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-pairengine.h"
+#include "o2at-stagedfill.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -33,13 +35,20 @@ using MyCompleteTracks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA
 //that is in principle more efficient.
 struct twoparcorcombexample {
   //Fully declarative!
-  Partition<o2::aod::Tracks> triggerTracks = aod::track::pt > 2;
-  Partition<o2::aod::Tracks> assocTracks = aod::track::pt < 2;
+  Partition<o2::aod::Tracks> triggerTracks = aod::track::pt > 2.f;
+  Partition<o2::aod::Tracks> assocTracks = aod::track::pt < 2.f;
   Filter etaFilter = nabs(aod::track::eta) < 0.5f;
   Filter trackQuality = aod::track::tpcNClsFindable - aod::track::tpcNClsFindableMinusCrossedRows >= 70;
-  Filter trackDCA = nabs(aod::track::dcaXY) <= .2;
+  Filter trackDCA = nabs(aod::track::dcaXY) <= .2f;
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
+  //Opt-in pair engine (o2at-pairengine.h): faster at high multiplicity, but it
+  //replaces the combinations below, which are the subject of this step
+  Configurable<bool> usePairEngine{"usePairEngine", false, "Fill correlationFunction with the cached-buffer pair engine"};
+  //Configurables to keep only the pairs within a |delta eta|, |delta phi| window (pair engine only).
+  //The pairs are then searched in an eta-phi grid instead of looping over all of them
+  Configurable<float> pairWindowDeltaEta{"pairWindowDeltaEta", 0.f, "Keep only pairs with |delta eta| below this (0: all pairs)"};
+  Configurable<float> pairWindowDeltaPhi{"pairWindowDeltaPhi", 0.f, "Keep only pairs with |delta phi| below this (0: all pairs)"};
   // histogram defined with HistogramRegistry
   HistogramRegistry registry{
     "registry",
@@ -53,7 +62,27 @@ struct twoparcorcombexample {
       
     }
   };
+
+  //Histogram handles, bound once in init(), with their staging buffers
+  o2at::StagedFill1D etaHistogramTriggerFill;
+  o2at::StagedFill1D ptHistogramTriggerFill;
+  o2at::StagedFill1D etaHistogramAssocFill;
+  o2at::StagedFill1D ptHistogramAssocFill;
   
+  //Per-collision buffers for the pair engine (kept as members to reuse memory)
+  o2at::PairTrackBuffer triggerBuffer;
+  o2at::PairTrackBuffer assocBuffer;
+  o2at::PairEngine pairEngine;
+
+  void init(InitContext const&)
+  {
+    etaHistogramTriggerFill.bind(registry.get<TH1>(HIST("etaHistogramTrigger")));
+    ptHistogramTriggerFill.bind(registry.get<TH1>(HIST("ptHistogramTrigger")));
+    etaHistogramAssocFill.bind(registry.get<TH1>(HIST("etaHistogramAssoc")));
+    ptHistogramAssocFill.bind(registry.get<TH1>(HIST("ptHistogramAssoc")));
+    pairEngine.bind(registry.get<TH2>(HIST("correlationFunction")));
+  }
+
   Double_t ComputeDeltaPhi( Double_t phi1, Double_t phi2) {
       //To be completely sure, use inner products
       Double_t x1, y1, x2, y2;
@@ -79,21 +108,56 @@ struct twoparcorcombexample {
       return lReturnVal;
   }
 
+  //Push the staged values to the histograms once per call
+  void flushInspectionHistograms()
+  {
+    etaHistogramTriggerFill.flush();
+    ptHistogramTriggerFill.flush();
+    etaHistogramAssocFill.flush();
+    ptHistogramAssocFill.flush();
+  }
+
   void process(aod::Collision const& collision, soa::Filtered<MyCompleteTracks> const& tracks) 
   {
     //Fill the event counter
     //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+
+    //Pair engine: eta and phi of the tracks of the two partitions are cached
+    //once per track, and then all pairs are binned in one go
+    if (usePairEngine) {
+      triggerBuffer.clear();
+      assocBuffer.clear();
+      for (auto& track : triggerTracks) {
+        etaHistogramTriggerFill.push(track.eta());
+        ptHistogramTriggerFill.push(track.pt());
+        triggerBuffer.push(track.eta(), track.phi());
+      }
+      for (auto& track : assocTracks) {
+        etaHistogramAssocFill.push(track.eta());
+        ptHistogramAssocFill.push(track.pt());
+        assocBuffer.push(track.eta(), track.phi());
+      }
+      flushInspectionHistograms();
+      if (pairWindowDeltaEta > 0.f && pairWindowDeltaPhi > 0.f) {
+        pairEngine.fillWindowed(triggerBuffer, assocBuffer, pairWindowDeltaEta, pairWindowDeltaPhi);
+      } else {
+        pairEngine.fill(triggerBuffer, assocBuffer);
+      }
+      pairEngine.flush();
+      return;
+    }
     
     //Inspect the trigger and associated populations
     for (auto track : triggerTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramTrigger"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramTrigger"))->Fill(track.pt());
+      etaHistogramTriggerFill.push(track.eta()); //<- this should show the selection
+      ptHistogramTriggerFill.push(track.pt());
     }
     for (auto track : assocTracks) { //<- only for a subset
-      registry.get<TH1>(HIST("etaHistogramAssoc"))->Fill(track.eta()); //<- this should show the selection
-      registry.get<TH1>(HIST("ptHistogramAssoc"))->Fill(track.pt());
+      etaHistogramAssocFill.push(track.eta()); //<- this should show the selection
+      ptHistogramAssocFill.push(track.pt());
     }
+    flushInspectionHistograms();
     
     //Now we do two-particle correlations, using "combinations"
     for (auto& [trackTrigger, trackAssoc] : combinations(triggerTracks, assocTracks)) {  //<- this is the main change
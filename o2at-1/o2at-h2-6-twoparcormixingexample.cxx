@@ -0,0 +1,141 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \brief This task extends the two-particle correlation examples of the
+///        second part of the tutorial with event mixing: the same-event and
+///        the mixed-event correlation functions are filled in the same pass.
+/// \author
+/// \since
+
+#include "Framework/runDataProcessing.h"
+#include "Framework/AnalysisTask.h"
+#include "Common/DataModel/TrackSelectionTables.h"
+#include "o2at-pairengine.h"
+
+using namespace o2;
+using namespace o2::framework;
+using namespace o2::framework::expressions;
+
+//This is an example of a conveient declaration of "using"
+using MyCompleteTracks = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA>;
+
+//STEP 6: Event mixing in the same pass
+//Associated tracks of past collisions are kept in small pools binned in
+//vertex-z and multiplicity. Every new collision is first mixed with the
+//pool it belongs to (trigger of this collision x associated of the past ones),
+//and then its associated tracks are added to the pool.
+struct twoparcormixingexample {
+  //The trigger (pt > 2) and associated (pt < 2) split is done in one pass in process
+  Filter etaFilter = nabs(aod::track::eta) < 0.5f;
+  Filter trackQuality = aod::track::tpcNClsFindable - aod::track::tpcNClsFindableMinusCrossedRows >= 70;
+  Filter trackDCA = nabs(aod::track::dcaXY) <= .2f;
+  //Configurable for number of bins
+  Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
+  //Configurables for the mixing pools: vertex-z bins are the ones of hVertexZ
+  Configurable<std::vector<float>> multBinEdges{"multBinEdges", {0., 10., 20., 40., 80., 160., 100000.}, "Multiplicity bin edges of the mixing pools"};
+  Configurable<int> poolDepth{"poolDepth", 5, "Number of past collisions kept in each mixing pool"};
+  Configurable<int> poolMemoryCap{"poolMemoryCap", 256, "Maximum memory used by all mixing pools (MB)"};
+  // histogram defined with HistogramRegistry
+  HistogramRegistry registry{
+    "registry",
+    {
+      {"hVertexZ", "hVertexZ", {HistType::kTH1F, {{nBins, -15., 15.}}}},
+      {"hMultiplicity", "hMultiplicity", {HistType::kTH1F, {{200, 0., 200.}}}},
+      {"correlationFunction", "correlationFunction", {HistType::kTH2F, {{40, -1.6, 1.6}, {40,-0.5*M_PI, 1.5*M_PI}}}},
+      {"correlationFunctionMixed", "correlationFunctionMixed", {HistType::kTH2F, {{40, -1.6, 1.6}, {40,-0.5*M_PI, 1.5*M_PI}}}},
+      {"hMixedEvents", "hMixedEvents", {HistType::kTH1F, {{20, -0.5, 19.5}}}}
+    }
+  };
+
+  //Per-collision buffers and pair engines (one per correlation function)
+  o2at::PairTrackBuffer triggerBuffer;
+  o2at::PairTrackBuffer assocBuffer;
+  o2at::PairEngine sameEventEngine;
+  o2at::PairEngine mixedEventEngine;
+
+  //Mixing pools, indexed by vertex-z bin and multiplicity bin
+  std::vector<o2at::MixingPool> pools;
+  TAxis const* vertexZAxis = nullptr;
+
+  void init(InitContext const&)
+  {
+    sameEventEngine.bind(registry.get<TH2>(HIST("correlationFunction")));
+    mixedEventEngine.bind(registry.get<TH2>(HIST("correlationFunctionMixed")));
+    vertexZAxis = registry.get<TH1>(HIST("hVertexZ"))->GetXaxis();
+    if (multBinEdges.value.size() < 2 || poolDepth <= 0 || poolMemoryCap <= 0) {
+      LOG(fatal) << "Mixing pools need at least two multiplicity bin edges, a positive depth and a positive memory cap";
+    }
+    pools.resize(vertexZAxis->GetNbins() * (multBinEdges.value.size() - 1));
+    //The memory cap is shared evenly between the pools: each of them only takes
+    //the memory of the events it actually stores, up to its share
+    const size_t lCapacity = (size_t(poolMemoryCap.value) << 20) / (pools.size() * 2 * sizeof(float));
+    for (auto& pool : pools) {
+      pool.setLimits(poolDepth, lCapacity);
+    }
+  }
+
+  //Returns the mixing pool of this collision, or nullptr if outside of the binning
+  o2at::MixingPool* findPool(float posZ, size_t multiplicity)
+  {
+    int lBinZ = vertexZAxis->FindFixBin(posZ);
+    if (lBinZ < 1 || lBinZ > vertexZAxis->GetNbins()) {
+      return nullptr;
+    }
+    auto const& lEdges = multBinEdges.value;
+    for (size_t iMult = 0; iMult + 1 < lEdges.size(); iMult++) {
+      if (multiplicity >= lEdges[iMult] && multiplicity < lEdges[iMult + 1]) {
+        return &pools[(lBinZ - 1) * (lEdges.size() - 1) + iMult];
+      }
+    }
+    return nullptr;
+  }
+
+  void process(aod::Collision const& collision, soa::Filtered<MyCompleteTracks> const& tracks)
+  {
+    //Fill the event counter
+    //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
+    registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+    registry.get<TH1>(HIST("hMultiplicity"))->Fill(tracks.size());
+
+    triggerBuffer.clear();
+    assocBuffer.clear();
+    for (auto& track : tracks) {
+      if (track.pt() > 2) {
+        triggerBuffer.push(track.eta(), track.phi());
+      } else if (track.pt() < 2) {
+        assocBuffer.push(track.eta(), track.phi());
+      }
+    }
+
+    //Same event
+    sameEventEngine.fill(triggerBuffer, assocBuffer);
+    sameEventEngine.flush();
+
+    //Mixed event: trigger of this collision with associated of past collisions
+    auto pool = findPool(collision.posZ(), tracks.size());
+    if (!pool) {
+      return;
+    }
+    registry.get<TH1>(HIST("hMixedEvents"))->Fill(pool->size());
+    for (size_t iEvent = 0; iEvent < pool->size(); iEvent++) {
+      mixedEventEngine.fill(triggerBuffer, pool->at(iEvent));
+    }
+    mixedEventEngine.flush();
+    pool->push(assocBuffer);
+  }
+};
+
+WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
+{
+  return WorkflowSpec{
+    adaptAnalysisTask<twoparcormixingexample>(cfgc)
+  };
+}
@@ -32,6 +32,11 @@ struct vzeroexample {
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
 
+  //Basic event selection (all helper tasks are now included!) as a Filter on the
+  //collisions: process is only called for the selected ones, and the V0s and
+  //tracks of the rejected collisions are never grouped
+  Filter eventFilter = aod::evsel::sel8 == true;
+
   // histogram defined with HistogramRegistry
   HistogramRegistry registry{
     "registry",
@@ -41,12 +46,8 @@ struct vzeroexample {
     }
   };
 
-  void process(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, aod::V0Datas const& V0s)
+  void process(soa::Filtered<soa::Join<aod::Collisions, aod::EvSels>>::iterator const& collision, aod::V0Datas const& V0s)
   {
-    //Basic event selection (all helper tasks are now included!)
-    if (!collision.sel8()) {
-      return;
-    }
     //Fill the event counter
     //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
@@ -26,6 +26,38 @@ using namespace o2::framework::expressions;
 //STEP 2
 //V0 property filtering and selecting
 
+//Dynamic columns such as v0radius() and v0cosPA(...) cannot be used in a Filter.
+//They can be materialized into real columns of a table joinable with V0Datas,
+//computed by a small helper task once per time frame: every task of the workflow
+//that subscribes to this table then shares the same values, and can filter on them.
+namespace o2::aod
+{
+namespace v0cache
+{
+DECLARE_SOA_COLUMN(CachedV0Radius, cachedV0Radius, float); //!
+DECLARE_SOA_COLUMN(CachedV0CosPA, cachedV0CosPA, double);  //! double, as the v0cospa Configurable
+} // namespace v0cache
+
+DECLARE_SOA_TABLE(V0Caches, "AOD", "V0CACHE", //!
+                  v0cache::CachedV0Radius,
+                  v0cache::CachedV0CosPA);
+} // namespace o2::aod
+
+using CachedV0s = soa::Join<aod::V0Datas, aod::V0Caches>;
+
+struct vzerocachebuilder {
+  Produces<aod::V0Caches> v0caches;
+
+  //one row per V0, in the same order as V0Datas (hence no grouping here)
+  void process(aod::V0Datas const& V0s, aod::Collisions const&)
+  {
+    for (auto& v0 : V0s) {
+      auto collision = v0.collision();
+      v0caches(v0.v0radius(), v0.v0cosPA(collision.posX(), collision.posY(), collision.posZ()));
+    }
+  }
+};
+
 struct vzerofilterexample {
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
@@ -37,9 +69,14 @@ struct vzerofilterexample {
   Configurable<float> dcapostopv{"dcapostopv", .1, "DCA Pos To PV"};
   Configurable<float> v0radius{"v0radius", 0.5, "v0radius"};
 
-  //Cannot filter on dynamic columns, so we cut on DCA to PV and DCA between daus only!
+  //All 5 selections can be done in the Filter, thanks to the materialized columns
   Filter preFilterV0 = nabs(aod::v0data::dcapostopv) > dcapostopv&& nabs(aod::v0data::dcanegtopv) > dcanegtopv&& aod::v0data::dcaV0daughters < dcav0dau;
+  Filter topologyFilterV0 = aod::v0cache::cachedV0Radius > v0radius&& aod::v0cache::cachedV0CosPA > v0cospa;
   
+  //Basic event selection (all helper tasks are now included!) as a Filter on the
+  //collisions, as in vzeroexample
+  Filter eventFilter = aod::evsel::sel8 == true;
+
   // histogram defined with HistogramRegistry
   HistogramRegistry registry{
     "registry",
@@ -49,18 +86,12 @@ struct vzerofilterexample {
     }
   };
 
-  void process(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<aod::V0Datas> const& V0s)
+  void process(soa::Filtered<soa::Join<aod::Collisions, aod::EvSels>>::iterator const& collision, soa::Filtered<CachedV0s> const& V0s)
   {
-    //Basic event selection (all helper tasks are now included!)
-    if (!collision.sel8()) {
-      return;
-    }
     //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
     for (auto& v0 : V0s) {
-      if (v0.v0radius() > v0radius && v0.v0cosPA(collision.posX(), collision.posY(), collision.posZ()) > v0cospa){
-        registry.fill(HIST("hMassK0Short"), v0.mK0Short());
-      }
+      registry.fill(HIST("hMassK0Short"), v0.mK0Short());
     }
   }
 };
@@ -68,6 +99,7 @@ struct vzerofilterexample {
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
 {
   return WorkflowSpec{
+    adaptAnalysisTask<vzerocachebuilder>(cfgc),
     adaptAnalysisTask<vzerofilterexample>(cfgc)
   };
 }
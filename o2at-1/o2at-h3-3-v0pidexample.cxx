@@ -19,6 +19,7 @@
 #include "PWGLF/DataModel/LFStrangenessTables.h"
 #include "Common/DataModel/EventSelection.h"
 #include "Common/DataModel/PIDResponse.h"
+#include "o2at-v0daughters.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -43,6 +44,10 @@ struct vzeropidexample {
   //Cannot filter on dynamic columns, so we cut on DCA to PV and DCA between daus only!
   Filter preFilterV0 = nabs(aod::v0data::dcapostopv) > dcapostopv&& nabs(aod::v0data::dcanegtopv) > dcanegtopv&& aod::v0data::dcaV0daughters < dcav0dau;
   
+  //Basic event selection (all helper tasks are now included!) as a Filter on the
+  //collisions, as in vzeroexample
+  Filter eventFilter = aod::evsel::sel8 == true;
+
   // histogram defined with HistogramRegistry
   HistogramRegistry registry{
     "registry",
@@ -54,20 +59,22 @@ struct vzeropidexample {
     }
   };
 
-  void process(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<aod::V0Datas> const& V0s, MyTracks const& tracks)
+  //Daughter n-sigmas of the V0s of the current collision
+  o2at::V0DaughterPID daughters;
+
+  void process(soa::Filtered<soa::Join<aod::Collisions, aod::EvSels>>::iterator const& collision, soa::Filtered<aod::V0Datas> const& V0s, MyTracks const& tracks)
   {
-    //Basic event selection (all helper tasks are now included!)
-    if (!collision.sel8()) {
-      return;
-    }
-    
     //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+    //Each daughter is dereferenced once, then the loop reads the gathered values
+    daughters.gather<MyTracks>(V0s);
+    size_t iV0 = 0;
     for (auto& v0 : V0s) {
-      float nsigma_pos_proton = TMath::Abs(v0.posTrack_as<MyTracks>().tpcNSigmaPr());
-      float nsigma_neg_proton = TMath::Abs(v0.negTrack_as<MyTracks>().tpcNSigmaPr());
-      float nsigma_pos_pion = TMath::Abs(v0.posTrack_as<MyTracks>().tpcNSigmaPi());
-      float nsigma_neg_pion = TMath::Abs(v0.negTrack_as<MyTracks>().tpcNSigmaPi());
+      float nsigma_pos_proton = daughters.posNSigmaPr[iV0];
+      float nsigma_neg_proton = daughters.negNSigmaPr[iV0];
+      float nsigma_pos_pion = daughters.posNSigmaPi[iV0];
+      float nsigma_neg_pion = daughters.negNSigmaPi[iV0];
+      iV0++;
       
       if (v0.v0radius() > v0radius && v0.v0cosPA(collision.posX(), collision.posY(), collision.posZ()) > v0cospa){
         if( nsigma_pos_pion < 4 && nsigma_neg_pion < 4 ){
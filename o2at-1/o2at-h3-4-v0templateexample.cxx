@@ -13,23 +13,53 @@
 /// \author
 /// \since
 
-#include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "PWGLF/DataModel/LFStrangenessTables.h"
 #include "Common/DataModel/EventSelection.h"
 #include "Common/DataModel/PIDResponse.h"
+#include "o2at-v0daughters.h"
+#include "o2at-profiling.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
 
+//The data-taking period is chosen when the workflow is built, i.e. before
+//the topology is defined: only the task of that period is added, so only its
+//tables are requested (--isRun3 false for Run 2 data). N.B.: customize() has
+//to be defined before including runDataProcessing.h
+void customize(std::vector<ConfigParamSpec>& workflowOptions)
+{
+  workflowOptions.push_back(ConfigParamSpec{"isRun3", VariantType::Bool, true, {"Process Run 3 data (false: Run 2 data)"}});
+}
+
+#include "Framework/runDataProcessing.h"
+
 //STEP 4
-//Now adding two process functions
-using MyTracksRun2 = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksCov, aod::TracksDCA, aod::pidTPCPi, aod::pidTPCPr>;
-using MyTracksRun3 = soa::Join<aod::TracksIU, aod::TracksExtra, aod::TracksCovIU, aod::TracksDCA, aod::pidTPCPi, aod::pidTPCPr>;
+//Now one process function for both data-taking periods. The usual way is to
+//add two process functions, processRun2 and processRun3, each with its own
+//track type and event selection, and to choose one at run time with
+//PROCESS_SWITCH (as in vzeromcexample, STEP 5). Here instead the period is a
+//template parameter of the task: the process function is written once, and
+//only the task of the chosen period is added to the workflow
+//N.B.: only subscribe to the tables whose columns are actually used! Every table
+//in the Join is read (and decompressed) from the AO2D, even if no getter of it is
+//called: here only the TPC PID of the daughters is needed, so e.g. the large
+//covariance tables (TracksCov, TracksCovIU) are not requested.
+using MyTracksRun2 = soa::Join<aod::Tracks, aod::pidTPCPi, aod::pidTPCPr>;
+using MyTracksRun3 = soa::Join<aod::TracksIU, aod::pidTPCPi, aod::pidTPCPr>;
 
+template <bool isRun3>
 struct vzerotemplateexample {
+  using MyTracks = std::conditional_t<isRun3, MyTracksRun3, MyTracksRun2>;
+
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
   
@@ -40,9 +70,20 @@ struct vzerotemplateexample {
   Configurable<float> dcapostopv{"dcapostopv", .1, "DCA Pos To PV"};
   Configurable<float> v0radius{"v0radius", 0.5, "v0radius"};
 
+  //Scan mode, e.g. for systematics: the topological selections are repeated for
+  //every combination of the values below (the nominal value is used for an empty
+  //list), in the same pass over the data. Each variant fills its own histograms
+  //in scan/variant<N>. The selections of the Filters are common to all variants
+  Configurable<std::vector<double>> scanV0CosPA{"scanV0CosPA", std::vector<double>{}, "V0 CosPA values of the scan (empty: nominal only)"};
+  Configurable<std::vector<float>> scanV0Radius{"scanV0Radius", std::vector<float>{}, "v0radius values of the scan (empty: nominal only)"};
+
   //Cannot filter on dynamic columns, so we cut on DCA to PV and DCA between daus only!
   Filter preFilterV0 = nabs(aod::v0data::dcapostopv) > dcapostopv&& nabs(aod::v0data::dcanegtopv) > dcanegtopv&& aod::v0data::dcaV0daughters < dcav0dau;
   
+  //Basic event selection (all helper tasks are now included!) as a Filter on the
+  //collisions, as in vzeroexample
+  Filter eventFilter = isRun3 ? (aod::evsel::sel8 == true) : (aod::evsel::sel7 == true);
+
   // histogram defined with HistogramRegistry
   HistogramRegistry registry{
     "registry",
@@ -54,66 +95,146 @@ struct vzerotemplateexample {
     }
   };
   
-  template <class TMyTracks, typename TV0>
-  void processV0Candidate(TV0 const& v0, float const& pvx, float const& pvy, float const& pvz)
-  //function to process a vzero candidate freely, actually with the right track type!
+  //Daughter n-sigmas of the V0s of the current collision, gathered with the right track type
+  o2at::V0DaughterPID daughters;
+
+  //Variants of the scan, with their histograms
+  struct ScanVariant {
+    double v0cospa;
+    float v0radius;
+    std::shared_ptr<TH1> hMassK0Short;
+    std::shared_ptr<TH1> hMassLambda;
+    std::shared_ptr<TH1> hMassAntiLambda;
+  };
+  std::vector<ScanVariant> scanVariants;
+  float loosestV0Radius = 0.f; //<- below this, no selection accepts the V0
+
+  //Timers and counters, only active when compiled with -DO2AT_PROFILING. The
+  //timers measure whole stages of a collision: a timer per V0 would cost about
+  //as much as what it measures
+  o2at::Profiler profiler;
+  int timerProcess = profiler.addTimer("process");
+  int timerGather = profiler.addTimer("daughter gather");
+  int timerV0s = profiler.addTimer("V0 selection and fills");
+  int counterSelectedCollisions = profiler.addCounter("selected collisions");
+  int counterFilteredV0s = profiler.addCounter("V0s after Filter");
+  int counterTopologyV0s = profiler.addCounter("V0s after topology");
+  int counterFills = profiler.addCounter("histogram fills");
+
+  void init(InitContext const&)
   {
-    auto posTrackCast = v0.template posTrack_as<TMyTracks>();
-    auto negTrackCast = v0.template negTrack_as<TMyTracks>();
-    
-    float nsigma_pos_proton = TMath::Abs(posTrackCast.tpcNSigmaPr());
-    float nsigma_neg_proton = TMath::Abs(posTrackCast.tpcNSigmaPr());
-    float nsigma_pos_pion = TMath::Abs(negTrackCast.tpcNSigmaPi());
-    float nsigma_neg_pion = TMath::Abs(negTrackCast.tpcNSigmaPi());
+    if (o2at::Profiler::enabled()) {
+      const int lNTimers = profiler.nTimers();
+      const int lNCounters = profiler.nCounters();
+      profiler.bind(registry.add<TH1>("profiling/hSeconds", "wall time (s)", {HistType::kTH1D, {{lNTimers, 0., double(lNTimers)}}}),
+                    registry.add<TH1>("profiling/hCalls", "calls", {HistType::kTH1D, {{lNTimers, 0., double(lNTimers)}}}),
+                    registry.add<TH1>("profiling/hCounts", "counts", {HistType::kTH1D, {{lNCounters, 0., double(lNCounters)}}}));
+    }
+
+    loosestV0Radius = v0radius.value;
+    if (!scanV0CosPA.value.empty() || !scanV0Radius.value.empty()) {
+      std::vector<double> lCosPAs = scanV0CosPA.value.empty() ? std::vector<double>{v0cospa.value} : scanV0CosPA.value;
+      std::vector<float> lRadii = scanV0Radius.value.empty() ? std::vector<float>{v0radius.value} : scanV0Radius.value;
+      for (auto lCosPA : lCosPAs) {
+        for (auto lRadius : lRadii) {
+          const std::string lFolder = "scan/variant" + std::to_string(scanVariants.size()) + "/";
+          const std::string lTitle = Form("cos(PA) > %.4f, radius > %.2f cm", lCosPA, lRadius);
+          scanVariants.push_back({lCosPA, lRadius,
+                                  registry.add<TH1>((lFolder + "hMassK0Short").c_str(), lTitle.c_str(), {HistType::kTH1F, {{200, 0.450f, 0.550f}}}),
+                                  registry.add<TH1>((lFolder + "hMassLambda").c_str(), lTitle.c_str(), {HistType::kTH1F, {{200, 1.015f, 1.215f}}}),
+                                  registry.add<TH1>((lFolder + "hMassAntiLambda").c_str(), lTitle.c_str(), {HistType::kTH1F, {{200, 1.015f, 1.215f}}})});
+          loosestV0Radius = std::min(loosestV0Radius, lRadius);
+        }
+      }
+    }
+  }
+
+  template <typename TV0>
+  void processV0Candidate(TV0 const& v0, size_t iV0, float const& pvx, float const& pvy, float const& pvz)
+  //function to process a vzero candidate freely, the daughter information being already gathered
+  {
+    float nsigma_pos_proton = daughters.posNSigmaPr[iV0];
+    float nsigma_neg_proton = daughters.negNSigmaPr[iV0];
+    float nsigma_pos_pion = daughters.posNSigmaPi[iV0];
+    float nsigma_neg_pion = daughters.negNSigmaPi[iV0];
     
-    if (v0.v0radius() > v0radius && v0.v0cosPA(pvx, pvy, pvz) > v0cospa){
+    //Radius and pointing angle are evaluated once, for the nominal selection and all the variants
+    const float lV0Radius = v0.v0radius();
+    double lV0CosPA = -1.;
+    if (lV0Radius > loosestV0Radius) { //<- otherwise the pointing angle is not needed
+      lV0CosPA = v0.v0cosPA(pvx, pvy, pvz);
+    }
+    bool passesTopology = lV0Radius > v0radius && lV0CosPA > v0cospa;
+    if (passesTopology){
+      profiler.count(counterTopologyV0s);
       if( nsigma_pos_pion < 4 && nsigma_neg_pion < 4 ){
         registry.fill(HIST("hMassK0Short"), v0.mK0Short());
+        profiler.count(counterFills);
       }
       if( nsigma_pos_proton < 4 && nsigma_neg_pion < 4 ){
         registry.fill(HIST("hMassLambda"), v0.mLambda());
+        profiler.count(counterFills);
       }
       if( nsigma_pos_pion < 4 && nsigma_neg_proton < 4 ){
         registry.fill(HIST("hMassAntiLambda"), v0.mAntiLambda());
+        profiler.count(counterFills);
       }
     }
-  }
 
-  //define first process function, used to process Run2 data
-  void processRun2(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<aod::V0Datas> const& V0s, MyTracksRun2 const& tracks)
-  {
-    //Basic event selection (all helper tasks are now included!)
-    if (!collision.sel7()) {
+    if (scanVariants.empty() || !(lV0Radius > loosestV0Radius)) {
       return;
     }
-    //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
-    registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
-    for (auto& v0 : V0s) {
-      processV0Candidate<MyTracksRun2>(v0, collision.posX(), collision.posY(), collision.posZ());
+    //Same V0 and same PID for all the variants: the masses are computed once
+    const bool isK0Short = nsigma_pos_pion < 4 && nsigma_neg_pion < 4;
+    const bool isLambda = nsigma_pos_proton < 4 && nsigma_neg_pion < 4;
+    const bool isAntiLambda = nsigma_pos_pion < 4 && nsigma_neg_proton < 4;
+    const float lMassK0Short = isK0Short ? v0.mK0Short() : 0.f;
+    const float lMassLambda = isLambda ? v0.mLambda() : 0.f;
+    const float lMassAntiLambda = isAntiLambda ? v0.mAntiLambda() : 0.f;
+    for (auto& variant : scanVariants) {
+      if (lV0Radius > variant.v0radius && lV0CosPA > variant.v0cospa) {
+        if (isK0Short) {
+          variant.hMassK0Short->Fill(lMassK0Short);
+        }
+        if (isLambda) {
+          variant.hMassLambda->Fill(lMassLambda);
+        }
+        if (isAntiLambda) {
+          variant.hMassAntiLambda->Fill(lMassAntiLambda);
+        }
+      }
     }
   }
-  PROCESS_SWITCH(vzerotemplateexample, processRun2, "Process Run 2 data", false);
 
-  //define second process function, used to process Run3 data
-  void processRun3(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<aod::V0Datas> const& V0s, MyTracksRun3 const& tracks)
+  void process(soa::Filtered<soa::Join<aod::Collisions, aod::EvSels>>::iterator const& collision, soa::Filtered<aod::V0Datas> const& V0s, MyTracks const& tracks)
   {
-    //Basic event selection (all helper tasks are now included!)
-    if (!collision.sel8()) {
-      return;
-    }
+    o2at::Profiler::Report report(profiler);
+    o2at::Profiler::Scope timer(profiler, timerProcess);
+    profiler.count(counterSelectedCollisions);
     //check getter here: https://aliceo2group.github.io/analysis-framework/docs/datamodel/ao2dTables.html
     registry.get<TH1>(HIST("hVertexZ"))->Fill(collision.posZ());
+    profiler.count(counterFilteredV0s, V0s.size());
+    {
+      o2at::Profiler::Scope timerGatherScope(profiler, timerGather);
+      daughters.gather<MyTracks>(V0s);
+    }
+    o2at::Profiler::Scope timerV0sScope(profiler, timerV0s);
+    size_t iV0 = 0;
     for (auto& v0 : V0s) {
-      processV0Candidate<MyTracksRun3>(v0, collision.posX(), collision.posY(), collision.posZ());
+      processV0Candidate(v0, iV0++, collision.posX(), collision.posY(), collision.posZ());
     }
   }
-  PROCESS_SWITCH(vzerotemplateexample, processRun3, "Process Run 3 data", true);
-  
 };
 
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
 {
+  //Same task name for both periods, so that the configuration is the same
+  if (cfgc.options().get<bool>("isRun3")) {
+    return WorkflowSpec{
+      adaptAnalysisTask<vzerotemplateexample<true>>(cfgc, TaskName{"vzerotemplateexample"})
+    };
+  }
   return WorkflowSpec{
-    adaptAnalysisTask<vzerotemplateexample>(cfgc)
+    adaptAnalysisTask<vzerotemplateexample<false>>(cfgc, TaskName{"vzerotemplateexample"})
   };
 }
@@ -31,6 +31,59 @@ using MyTracksRun2 = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksCov, ao
 using MyTracksRun3 = soa::Join<aod::TracksIU, aod::TracksExtra, aod::TracksCovIU, aod::TracksDCA, aod::pidTPCPi, aod::pidTPCPr>;
 using LabeledV0s = soa::Join<aod::V0Datas, aod::McV0Labels>;
 
+//The true species of each V0 is a small enum stored in a table joinable with
+//V0Datas. It is produced once per time frame by a helper task, the only one
+//that follows the MC labels into McParticles: the analysis tasks read it as
+//a plain column, and can use it in a Filter or a Partition like any other
+//(e.g. aod::v0truth::trueSpecies == static_cast<int8_t>(o2::aod::v0truth::kLambda)).
+namespace o2::aod
+{
+namespace v0truth
+{
+enum Species : int8_t {
+  kNotMatched = 0, //<- no MC association
+  kOther,
+  kK0Short,
+  kLambda,
+  kAntiLambda
+};
+DECLARE_SOA_COLUMN(TrueSpecies, trueSpecies, int8_t); //! one of Species
+} // namespace v0truth
+
+DECLARE_SOA_TABLE(V0TrueSpecies, "AOD", "V0TRUESPECIES", //!
+                  v0truth::TrueSpecies);
+} // namespace o2::aod
+
+using TruthV0s = soa::Join<aod::V0Datas, aod::V0TrueSpecies>;
+
+struct vzerotruthbuilder {
+  Produces<aod::V0TrueSpecies> v0truespecies;
+
+  //one row per V0, in the same order as V0Datas (hence no grouping here)
+  void process(LabeledV0s const& V0s, aod::McParticles const&)
+  {
+    for (auto& v0 : V0s) {
+      int8_t lSpecies = aod::v0truth::kNotMatched;
+      if (v0.has_mcParticle()) { //<- some association was made!
+        switch (v0.mcParticle().pdgCode()) {
+          case 310:
+            lSpecies = aod::v0truth::kK0Short;
+            break;
+          case 3122:
+            lSpecies = aod::v0truth::kLambda;
+            break;
+          case -3122:
+            lSpecies = aod::v0truth::kAntiLambda;
+            break;
+          default:
+            lSpecies = aod::v0truth::kOther;
+        }
+      }
+      v0truespecies(lSpecies);
+    }
+  }
+};
+
 struct vzeromcexample {
   //Configurable for number of bins
   Configurable<int> nBins{"nBins", 100, "N bins in all histos"};
@@ -67,8 +120,8 @@ struct vzeromcexample {
     auto negTrackCast = v0.template negTrack_as<TMyTracks>();
     
     float nsigma_pos_proton = TMath::Abs(posTrackCast.tpcNSigmaPr());
-    float nsigma_neg_proton = TMath::Abs(posTrackCast.tpcNSigmaPr());
-    float nsigma_pos_pion = TMath::Abs(negTrackCast.tpcNSigmaPi());
+    float nsigma_neg_proton = TMath::Abs(negTrackCast.tpcNSigmaPr());
+    float nsigma_pos_pion = TMath::Abs(posTrackCast.tpcNSigmaPi());
     float nsigma_neg_pion = TMath::Abs(negTrackCast.tpcNSigmaPi());
     
     if (v0.v0radius() > v0radius && v0.v0cosPA(pvx, pvy, pvz) > v0cospa){
@@ -82,19 +135,16 @@ struct vzeromcexample {
         registry.fill(HIST("hMassAntiLambda"), v0.mAntiLambda());
       }
       
-      if( v0.has_mcParticle()){ //<- some association was made!
-        auto v0mcparticle = v0.mcParticle();
-        //check particle PDG code to see if it's the one you want
-        if ( v0mcparticle.pdgCode() == 310 ) registry.fill(HIST("hMassTrueK0Short"), v0.mK0Short());
-        if ( v0mcparticle.pdgCode() == 3122 ) registry.fill(HIST("hMassLambda"), v0.mK0Short());
-        if ( v0mcparticle.pdgCode() ==-3122 ) registry.fill(HIST("hMassAntiLambda"), v0.mK0Short());
-      }
+      //check the true species to see if it's the one you want
+      if ( v0.trueSpecies() == aod::v0truth::kK0Short ) registry.fill(HIST("hMassTrueK0Short"), v0.mK0Short());
+      if ( v0.trueSpecies() == aod::v0truth::kLambda ) registry.fill(HIST("hMassTrueLambda"), v0.mLambda());
+      if ( v0.trueSpecies() == aod::v0truth::kAntiLambda ) registry.fill(HIST("hMassTrueAntiLambda"), v0.mAntiLambda());
       
     }
   }
   
   //define first process function, used to process Run2 data
-  void processRun2(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<LabeledV0s> const& V0s, MyTracksRun2 const& tracks)
+  void processRun2(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<TruthV0s> const& V0s, MyTracksRun2 const& tracks)
   {
     //Basic event selection (all helper tasks are now included!)
     if (!collision.sel7()) {
@@ -109,7 +159,7 @@ struct vzeromcexample {
   PROCESS_SWITCH(vzeromcexample, processRun2, "Process Run 2 data", false);
 
   //define first process function, used to process Run3 data
-  void processRun3(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<LabeledV0s> const& V0s, MyTracksRun3 const& tracks)
+  void processRun3(soa::Join<aod::Collisions, aod::EvSels>::iterator const& collision, soa::Filtered<TruthV0s> const& V0s, MyTracksRun3 const& tracks)
   {
     //Basic event selection (all helper tasks are now included!)
     if (!collision.sel8()) {
@@ -128,6 +178,7 @@ struct vzeromcexample {
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
 {
   return WorkflowSpec{
+    adaptAnalysisTask<vzerotruthbuilder>(cfgc),
     adaptAnalysisTask<vzeromcexample>(cfgc)
   };
 }
@@ -0,0 +1,72 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \brief Lazy gather of MC information for the selected tracks of a collision.
+///        Only the tracks that pass the cuts are registered, with their MC
+///        label, and the needed McParticles column (pt) is then read once per
+///        track in increasing label order, instead of one random access into
+///        the McParticles table in the middle of the track loop.
+/// \author
+/// \since
+
+#ifndef O2AT_MCGATHER_H_
+#define O2AT_MCGATHER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace o2at
+{
+
+//Reconstructed pt and MC label of the registered tracks, in registration order,
+//and the pt of their MC particles once gather() has been called
+class McPtGather
+{
+ public:
+  void clear()
+  {
+    mRecoPt.clear();
+    mLabel.clear();
+    mMcPt.clear();
+  }
+  void push(float recoPt, int64_t label)
+  {
+    mRecoPt.push_back(recoPt);
+    mLabel.push_back(label);
+  }
+  size_t size() const { return mRecoPt.size(); }
+  float recoPt(size_t i) const { return mRecoPt[i]; }
+  float mcPt(size_t i) const { return mMcPt[i]; }
+
+  template <typename TMcParticles>
+  void gather(TMcParticles const& mcParticles)
+  {
+    mOrder.resize(mLabel.size());
+    std::iota(mOrder.begin(), mOrder.end(), 0);
+    std::sort(mOrder.begin(), mOrder.end(), [this](uint32_t a, uint32_t b) { return mLabel[a] < mLabel[b]; });
+    mMcPt.resize(mLabel.size());
+    for (auto i : mOrder) {
+      mMcPt[i] = mcParticles.rawIteratorAt(mLabel[i]).pt(); //<- McParticles is read forward only
+    }
+  }
+
+ private:
+  std::vector<float> mRecoPt;
+  std::vector<int64_t> mLabel;
+  std::vector<float> mMcPt;
+  std::vector<uint32_t> mOrder;
+};
+
+} // namespace o2at
+
+#endif // O2AT_MCGATHER_H_
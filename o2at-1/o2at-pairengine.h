@@ -0,0 +1,463 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \brief Pair engine for the two-particle correlation examples.
+///        The per-track quantities are copied once per collision into
+///        contiguous float buffers, and the delta eta - delta phi binning
+///        of all trigger-associated pairs is done with plain arithmetic into
+///        a private dense bin array that is flushed once per collision.
+///        Also provides the event pools used for event mixing.
+/// \author
+/// \since
+
+#ifndef O2AT_PAIRENGINE_H_
+#define O2AT_PAIRENGINE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <TH2.h>
+#include <TAxis.h>
+#include <TArrayD.h>
+
+namespace o2at
+{
+
+//Structure-of-arrays buffer with the only two quantities used in the pair loop
+struct PairTrackBuffer {
+  std::vector<float> eta;
+  std::vector<float> phi;
+
+  void clear()
+  {
+    eta.clear();
+    phi.clear();
+  }
+  void push(float lEta, float lPhi)
+  {
+    eta.push_back(lEta);
+    phi.push_back(lPhi);
+  }
+  size_t size() const { return eta.size(); }
+};
+
+//Read-only view of the eta and phi arrays of a set of tracks: either a buffer
+//of the current collision or an event stored in a mixing pool
+struct PairTrackView {
+  float const* eta = nullptr;
+  float const* phi = nullptr;
+  size_t n = 0;
+
+  PairTrackView() = default;
+  PairTrackView(float const* lEta, float const* lPhi, size_t lN) : eta(lEta), phi(lPhi), n(lN) {}
+  PairTrackView(PairTrackBuffer const& buffer) : eta(buffer.eta.data()), phi(buffer.phi.data()), n(buffer.size()) {}
+  size_t size() const { return n; }
+};
+
+//Fixed-width axis description, evaluated exactly like TAxis::FindFixBin
+struct PairAxis {
+  int nBins = 1;
+  double min = 0.;
+  double max = 1.;
+
+  void set(TAxis const* axis)
+  {
+    nBins = axis->GetNbins();
+    min = axis->GetXmin();
+    max = axis->GetXmax();
+  }
+  //Returns 0 for underflow and nBins+1 for overflow, as ROOT does
+  int findBin(double x) const
+  {
+    if (x < min) {
+      return 0;
+    }
+    if (!(x < max)) {
+      return nBins + 1;
+    }
+    return 1 + int(nBins * (x - min) / (max - min));
+  }
+};
+
+//Delta phi of an associated particle with respect to the trigger, folded into
+//[-pi/2, 3pi/2): the same range and sign convention as the inner-product
+//ComputeDeltaPhi of the examples, but without any cos/sin/acos. The two agree
+//to 1e-9 or better, except within 1e-6 of 0 and pi: there the acos of
+//ComputeDeltaPhi loses precision, and it returns 0 for |sin| <= 1e-8 (i.e.
+//also for back-to-back pairs)
+inline double foldDeltaPhi(double phiTrigger, double phiAssoc)
+{
+  double lDeltaPhi = phiAssoc - phiTrigger;
+  lDeltaPhi = lDeltaPhi < -0.5 * M_PI ? lDeltaPhi + 2. * M_PI : lDeltaPhi;
+  lDeltaPhi = lDeltaPhi >= 1.5 * M_PI ? lDeltaPhi - 2. * M_PI : lDeltaPhi;
+  return lDeltaPhi;
+}
+
+//ComputeDeltaPhi of the examples, operation by operation (with the clamping of
+//TMath::ACos), for the pairs where the folded value may end up in another bin
+inline double referenceDeltaPhi(double phiTrigger, double phiAssoc)
+{
+  const double x1 = std::cos(phiTrigger);
+  const double y1 = std::sin(phiTrigger);
+  const double x2 = std::cos(phiAssoc);
+  const double y2 = std::sin(phiAssoc);
+  const double lInnerProd = x1 * x2 + y1 * y2;
+  const double lVectorProd = x1 * y2 - x2 * y1;
+  const double lAngle = lInnerProd < -1. ? M_PI : (lInnerProd > 1. ? 0. : std::acos(lInnerProd));
+  double lReturnVal = 0.;
+  if (lVectorProd > 1e-8) {
+    lReturnVal = lAngle;
+  }
+  if (lVectorProd < -1e-8) {
+    lReturnVal = -lAngle;
+  }
+  if (lReturnVal < -M_PI / 2.) {
+    lReturnVal += 2. * M_PI;
+  }
+  return lReturnVal;
+}
+
+//Eta-phi cell grid over a set of tracks, for pair searches restricted to a
+//|delta eta|, |delta phi| window: the cells are at least as large as the window,
+//so that all the partners of a track are in its cell or in the neighbouring ones
+//(phi wrapping around). The tracks are stored sorted by cell (counting sort)
+class PairGrid
+{
+ public:
+  void build(PairTrackView const& tracks, float cellEta, float cellPhi)
+  {
+    const size_t n = tracks.size();
+    mEtaMin = 0.f;
+    float lEtaRange = 0.f;
+    if (n > 0) {
+      auto lRange = std::minmax_element(tracks.eta, tracks.eta + n);
+      mEtaMin = *lRange.first;
+      lEtaRange = *lRange.second - *lRange.first;
+    }
+    //Cells as small as the window, but no more cells than tracks: smaller cells
+    //would be mostly empty and only cost memory and time (larger cells are
+    //always fine, the candidates are tested exactly)
+    const double lMaxCells = std::max<size_t>(n, 1);
+    double lNEta = std::clamp(std::floor(double(lEtaRange) / cellEta), 1., lMaxCells);
+    double lNPhi = std::clamp(std::floor(2. * M_PI / cellPhi), 1., lMaxCells);
+    if (lNEta * lNPhi > lMaxCells) {
+      const double lScale = std::sqrt(lMaxCells / (lNEta * lNPhi));
+      lNEta = std::max(1., std::floor(lNEta * lScale));
+      lNPhi = std::clamp(std::floor(lNPhi * lScale), 1., std::floor(lMaxCells / lNEta));
+    }
+    mNEta = int(lNEta);
+    mNPhi = int(lNPhi);
+    mEtaWidth = lEtaRange > 0.f ? lEtaRange / mNEta : 1.f;
+    mPhiWidth = 2. * M_PI / mNPhi;
+
+    //the buffers keep their capacity from one collision to the next
+    mStart.resize(mNEta * mNPhi + 1);
+    std::fill(mStart.begin(), mStart.end(), 0);
+    mCell.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      mCell[i] = etaCell(tracks.eta[i]) * mNPhi + phiCell(tracks.phi[i]);
+      mStart[mCell[i] + 1]++;
+    }
+    for (size_t iCell = 1; iCell < mStart.size(); iCell++) {
+      mStart[iCell] += mStart[iCell - 1];
+    }
+    mCursor.resize(mStart.size() - 1);
+    std::copy(mStart.begin(), mStart.end() - 1, mCursor.begin());
+    mEta.resize(n);
+    mPhi.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      const uint32_t lSlot = mCursor[mCell[i]]++;
+      mEta[lSlot] = tracks.eta[i];
+      mPhi[lSlot] = tracks.phi[i];
+    }
+  }
+
+  //Calls f(eta, phi) for every track in the cell of (eta, phi) and in the
+  //neighbouring ones: a superset of the tracks within the window
+  template <typename F>
+  void forEachCandidate(float eta, float phi, F&& f) const
+  {
+    const int lEtaCell = etaCell(eta);
+    const int lPhiCell = phiCell(phi);
+    for (int iEta = std::max(0, lEtaCell - 1); iEta <= std::min(mNEta - 1, lEtaCell + 1); iEta++) {
+      if (mNPhi < 3) { //<- the neighbours are all the cells
+        for (int iPhi = 0; iPhi < mNPhi; iPhi++) {
+          visit(iEta * mNPhi + iPhi, f);
+        }
+        continue;
+      }
+      for (int lDeltaCell = -1; lDeltaCell <= 1; lDeltaCell++) {
+        visit(iEta * mNPhi + (lPhiCell + lDeltaCell + mNPhi) % mNPhi, f);
+      }
+    }
+  }
+
+ private:
+  int etaCell(float eta) const
+  {
+    return std::clamp(int((eta - mEtaMin) / mEtaWidth), 0, mNEta - 1);
+  }
+  int phiCell(double phi) const
+  {
+    phi -= 2. * M_PI * std::floor(phi / (2. * M_PI)); //<- into [0, 2pi)
+    return std::clamp(int(phi / mPhiWidth), 0, mNPhi - 1);
+  }
+  template <typename F>
+  void visit(int iCell, F& f) const
+  {
+    for (uint32_t i = mStart[iCell]; i < mStart[iCell + 1]; i++) {
+      f(mEta[i], mPhi[i]);
+    }
+  }
+
+  float mEtaMin = 0.f;
+  float mEtaWidth = 1.f;
+  int mNEta = 1;
+  double mPhiWidth = 2. * M_PI;
+  int mNPhi = 1;
+  std::vector<uint32_t> mStart;
+  std::vector<uint32_t> mCursor;
+  std::vector<uint32_t> mCell;
+  std::vector<float> mEta;
+  std::vector<float> mPhi;
+};
+
+class PairEngine
+{
+ public:
+  //To be called once, e.g. in init(): caches the binning of the target histogram
+  void bind(std::shared_ptr<TH2> histogram)
+  {
+    mHistogram = histogram;
+    mAxisDeltaEta.set(histogram->GetXaxis());
+    mAxisDeltaPhi.set(histogram->GetYaxis());
+    mBinsPerRadian = mAxisDeltaPhi.nBins / (mAxisDeltaPhi.max - mAxisDeltaPhi.min);
+    mCounts.assign((mAxisDeltaEta.nBins + 2) * (mAxisDeltaPhi.nBins + 2), 0.);
+    mPairs = 0;
+  }
+
+  //Bin of delta phi, the same as with ComputeDeltaPhi: the folded value is used,
+  //except within kExactMargin of a bin edge or of 0 and pi, where the two may
+  //differ (dead zone of ComputeDeltaPhi, rounding of its acos) and the
+  //reference computation is done instead
+  int findDeltaPhiBin(double phiTrigger, double phiAssoc) const
+  {
+    const double lDeltaPhi = foldDeltaPhi(phiTrigger, phiAssoc);
+    const double lPosition = (lDeltaPhi - mAxisDeltaPhi.min) * mBinsPerRadian;
+    if (std::abs(lPosition - std::round(lPosition)) < kExactMargin * mBinsPerRadian ||
+        std::abs(lDeltaPhi) < kExactMargin || std::abs(lDeltaPhi - M_PI) < kExactMargin) {
+      return mAxisDeltaPhi.findBin(referenceDeltaPhi(phiTrigger, phiAssoc));
+    }
+    return mAxisDeltaPhi.findBin(lDeltaPhi);
+  }
+
+  //Accumulates all trigger x associated pairs into the private bin array
+  void fill(PairTrackView const& trigger, PairTrackView const& assoc)
+  {
+    const size_t nAssoc = assoc.size();
+    const int nBinsX = mAxisDeltaEta.nBins + 2;
+    mBins.resize(nAssoc);
+    for (size_t iTrigger = 0; iTrigger < trigger.size(); iTrigger++) {
+      const float lEtaTrigger = trigger.eta[iTrigger];
+      const double lPhiTrigger = trigger.phi[iTrigger];
+      //first pass: pure arithmetic, no dependency between iterations
+      for (size_t iAssoc = 0; iAssoc < nAssoc; iAssoc++) {
+        //delta eta is computed in float, exactly as in the explicit loop
+        const float lDeltaEta = lEtaTrigger - assoc.eta[iAssoc];
+        mBins[iAssoc] = mAxisDeltaEta.findBin(lDeltaEta) + nBinsX * findDeltaPhiBin(lPhiTrigger, assoc.phi[iAssoc]);
+      }
+      //second pass: scatter into the private bin array
+      for (size_t iAssoc = 0; iAssoc < nAssoc; iAssoc++) {
+        mCounts[mBins[iAssoc]] += 1.;
+      }
+    }
+    mPairs += trigger.size() * nAssoc;
+  }
+
+  //Same as fill(), for the pairs with |delta eta| < maxDeltaEta and |delta phi| <
+  //maxDeltaPhi only (the window is on delta phi as folded by foldDeltaPhi): the
+  //associated tracks are sorted into a grid, and only the neighbouring cells of
+  //each trigger are looked at. The bins of the selected pairs are those of fill()
+  void fillWindowed(PairTrackView const& trigger, PairTrackView const& assoc, float maxDeltaEta, float maxDeltaPhi)
+  {
+    const int nBinsX = mAxisDeltaEta.nBins + 2;
+    mGrid.build(assoc, maxDeltaEta, maxDeltaPhi);
+    for (size_t iTrigger = 0; iTrigger < trigger.size(); iTrigger++) {
+      const float lEtaTrigger = trigger.eta[iTrigger];
+      const double lPhiTrigger = trigger.phi[iTrigger];
+      mGrid.forEachCandidate(lEtaTrigger, lPhiTrigger, [&](float lEtaAssoc, float lPhiAssoc) {
+        const float lDeltaEta = lEtaTrigger - lEtaAssoc;
+        const double lDeltaPhi = foldDeltaPhi(lPhiTrigger, lPhiAssoc);
+        if (std::abs(lDeltaEta) < maxDeltaEta && std::abs(lDeltaPhi) < maxDeltaPhi) {
+          mCounts[mAxisDeltaEta.findBin(lDeltaEta) + nBinsX * findDeltaPhiBin(lPhiTrigger, lPhiAssoc)] += 1.;
+          mPairs++;
+        }
+      });
+    }
+  }
+
+  //Adds the accumulated counts to the histogram and resets the private array
+  void flush()
+  {
+    if (mPairs == 0) {
+      return;
+    }
+    TArrayD* lSumw2 = mHistogram->GetSumw2N() > 0 ? mHistogram->GetSumw2() : nullptr;
+    for (size_t iBin = 0; iBin < mCounts.size(); iBin++) {
+      if (mCounts[iBin] == 0.) {
+        continue;
+      }
+      mHistogram->AddBinContent(iBin, mCounts[iBin]);
+      if (lSumw2) {
+        lSumw2->fArray[iBin] += mCounts[iBin]; //<- unit weights
+      }
+      mCounts[iBin] = 0.;
+    }
+    mHistogram->SetEntries(mHistogram->GetEntries() + mPairs);
+    mPairs = 0;
+  }
+
+ private:
+  std::shared_ptr<TH2> mHistogram;
+  PairAxis mAxisDeltaEta;
+  PairAxis mAxisDeltaPhi;
+  double mBinsPerRadian = 1.;
+  static constexpr double kExactMargin = 1e-6; //<- far above the 1e-9 difference of the two delta phi
+  std::vector<double> mCounts;
+  std::vector<int> mBins;
+  PairGrid mGrid;
+  unsigned long mPairs = 0;
+};
+
+//Bounded ring buffer of compacted past events for event mixing. The storage of
+//the pool is one contiguous arena in which each event is written at a free
+//place: after the previous event, at the beginning of the arena, or after the
+//last stored event. The arena only grows when none of these is free once the
+//pool holds at most depth - 1 events, i.e. it follows the depth times the
+//multiplicity of the pool (up to a factor 2 from the geometric growth), and
+//never beyond "capacity" tracks: at that point the oldest events are evicted
+//to make room instead.
+//The pool keeps at most "depth" events.
+class MixingPool
+{
+ public:
+  void setLimits(size_t depth, size_t capacity)
+  {
+    mSlots.assign(depth, Slot{});
+    mCapacity = capacity;
+    mFirst = 0;
+    mFilled = 0;
+    mHead = 0;
+  }
+
+  //Number of events currently available for mixing
+  size_t size() const { return mFilled; }
+  PairTrackView at(size_t iEvent) const
+  {
+    Slot const& lSlot = mSlots[(mFirst + iEvent) % mSlots.size()];
+    return {mEta.data() + lSlot.offset, mPhi.data() + lSlot.offset, lSlot.size};
+  }
+
+  //Stores a copy of the tracks, evicting the oldest event if the pool is full,
+  //or more of them if the arena is at its capacity. Returns false if the event
+  //is larger than the largest allowed arena (nothing is stored then)
+  bool push(PairTrackView const& tracks)
+  {
+    const size_t n = tracks.size();
+    if (mSlots.empty() || n > mCapacity) {
+      return false;
+    }
+    if (mFilled == mSlots.size()) {
+      evictOldest();
+    }
+    size_t lOffset = 0;
+    while (!findFree(n, lOffset)) {
+      const size_t lTop = top();
+      if (lTop + n <= mCapacity) {
+        //grow geometrically: the offsets of the stored events stay valid
+        const size_t lSize = std::min(mCapacity, std::max(lTop + n, 2 * mEta.size()));
+        mEta.resize(lSize);
+        mPhi.resize(lSize);
+      } else {
+        evictOldest();
+      }
+    }
+    std::copy(tracks.eta, tracks.eta + n, mEta.begin() + lOffset);
+    std::copy(tracks.phi, tracks.phi + n, mPhi.begin() + lOffset);
+    mSlots[(mFirst + mFilled) % mSlots.size()] = Slot{lOffset, n};
+    mFilled++;
+    mHead = lOffset + n;
+    return true;
+  }
+
+ private:
+  struct Slot {
+    size_t offset = 0;
+    size_t size = 0;
+  };
+
+  void evictOldest()
+  {
+    mFirst = (mFirst + 1) % mSlots.size();
+    mFilled--;
+  }
+
+  //End of the storage of the stored events
+  size_t top() const
+  {
+    size_t lTop = 0;
+    for (size_t iEvent = 0; iEvent < mFilled; iEvent++) {
+      Slot const& lSlot = mSlots[(mFirst + iEvent) % mSlots.size()];
+      lTop = std::max(lTop, lSlot.offset + lSlot.size);
+    }
+    return lTop;
+  }
+
+  //First free place for n tracks in the current arena, among: after the last
+  //written event, at the beginning (wrap around) and after the stored events
+  bool findFree(size_t n, size_t& offset) const
+  {
+    for (size_t lCandidate : {mHead, size_t(0), top()}) {
+      if (lCandidate + n <= mEta.size() && !overlaps(lCandidate, n)) {
+        offset = lCandidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //Whether [offset, offset + n) intersects the storage of any stored event
+  bool overlaps(size_t offset, size_t n) const
+  {
+    for (size_t iEvent = 0; iEvent < mFilled; iEvent++) {
+      Slot const& lSlot = mSlots[(mFirst + iEvent) % mSlots.size()];
+      if (lSlot.offset < offset + n && offset < lSlot.offset + lSlot.size) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<Slot> mSlots;
+  std::vector<float> mEta;
+  std::vector<float> mPhi;
+  size_t mCapacity = 0;
+  size_t mFirst = 0;
+  size_t mFilled = 0;
+  size_t mHead = 0;
+};
+
+} // namespace o2at
+
+#endif // O2AT_PAIRENGINE_H_
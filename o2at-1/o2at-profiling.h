@@ -0,0 +1,172 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \brief Lightweight instrumentation for the tutorial tasks: scoped timers and
+///        counters declared as task members, reported as histograms in the
+///        output of the task. Only active when compiled with -DO2AT_PROFILING,
+///        otherwise every call is empty and optimized away.
+/// \author
+/// \since
+
+#ifndef O2AT_PROFILING_H_
+#define O2AT_PROFILING_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef O2AT_PROFILING
+#include <chrono>
+#endif
+
+#include <TH1.h>
+
+namespace o2at
+{
+
+#ifdef O2AT_PROFILING
+
+//Set of named timers and counters. Names are registered once (e.g. in init())
+//and return an index, so that the per-call cost is an array access plus,
+//for timers, two reads of the steady clock.
+class Profiler
+{
+ public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr bool enabled() { return true; }
+
+  int addTimer(std::string const& name)
+  {
+    mTimerNames.push_back(name);
+    mSeconds.push_back(0.);
+    mCalls.push_back(0);
+    return mTimerNames.size() - 1;
+  }
+  int addCounter(std::string const& name)
+  {
+    mCounterNames.push_back(name);
+    mCounts.push_back(0);
+    return mCounterNames.size() - 1;
+  }
+
+  void count(int counter, uint64_t n = 1) { mCounts[counter] += n; }
+
+  //Numbers of timers and counters, e.g. for the number of bins of the histograms
+  int nTimers() const { return mTimerNames.size(); }
+  int nCounters() const { return mCounterNames.size(); }
+
+  //Measures the wall time between its construction and its destruction
+  class Scope
+  {
+   public:
+    Scope(Profiler& profiler, int timer) : mProfiler(profiler), mTimer(timer), mStart(clock::now()) {}
+    ~Scope()
+    {
+      mProfiler.mSeconds[mTimer] += std::chrono::duration<double>(clock::now() - mStart).count();
+      mProfiler.mCalls[mTimer]++;
+    }
+
+   private:
+    Profiler& mProfiler;
+    int mTimer;
+    clock::time_point mStart;
+  };
+
+  //Calls report() on destruction: declared before the Scope of a process function,
+  //it reports after the time of the current call has been added
+  class Report
+  {
+   public:
+    Report(Profiler& profiler) : mProfiler(profiler) {}
+    ~Report() { mProfiler.report(); }
+
+   private:
+    Profiler& mProfiler;
+  };
+
+  //To be called once all timers and counters are added: one labelled bin per entry
+  void bind(std::shared_ptr<TH1> hSeconds, std::shared_ptr<TH1> hCalls, std::shared_ptr<TH1> hCounts)
+  {
+    mSecondsHistogram = hSeconds;
+    mCallsHistogram = hCalls;
+    mCountsHistogram = hCounts;
+    for (size_t i = 0; i < mTimerNames.size(); i++) {
+      mSecondsHistogram->GetXaxis()->SetBinLabel(i + 1, mTimerNames[i].c_str());
+      mCallsHistogram->GetXaxis()->SetBinLabel(i + 1, mTimerNames[i].c_str());
+    }
+    for (size_t i = 0; i < mCounterNames.size(); i++) {
+      mCountsHistogram->GetXaxis()->SetBinLabel(i + 1, mCounterNames[i].c_str());
+    }
+  }
+
+  //Copies the current values into the bound histograms
+  void report() const
+  {
+    if (!mSecondsHistogram) {
+      return;
+    }
+    for (size_t i = 0; i < mTimerNames.size(); i++) {
+      mSecondsHistogram->SetBinContent(i + 1, mSeconds[i]);
+      mCallsHistogram->SetBinContent(i + 1, mCalls[i]);
+    }
+    for (size_t i = 0; i < mCounterNames.size(); i++) {
+      mCountsHistogram->SetBinContent(i + 1, mCounts[i]);
+    }
+  }
+
+ private:
+  std::vector<std::string> mTimerNames;
+  std::vector<double> mSeconds;
+  std::vector<uint64_t> mCalls;
+  std::vector<std::string> mCounterNames;
+  std::vector<uint64_t> mCounts;
+  std::shared_ptr<TH1> mSecondsHistogram;
+  std::shared_ptr<TH1> mCallsHistogram;
+  std::shared_ptr<TH1> mCountsHistogram;
+};
+
+#else
+
+//Compiled-out version: same interface, no state, no work
+class Profiler
+{
+ public:
+  static constexpr bool enabled() { return false; }
+
+  int addTimer(std::string const&) { return 0; }
+  int addCounter(std::string const&) { return 0; }
+  void count(int, uint64_t = 1) {}
+  int nTimers() const { return 0; }
+  int nCounters() const { return 0; }
+
+  class Scope
+  {
+   public:
+    Scope(Profiler&, int) {}
+  };
+
+  class Report
+  {
+   public:
+    Report(Profiler&) {}
+  };
+
+  void bind(std::shared_ptr<TH1>, std::shared_ptr<TH1>, std::shared_ptr<TH1>) {}
+  void report() const {}
+};
+
+#endif
+
+} // namespace o2at
+
+#endif // O2AT_PROFILING_H_
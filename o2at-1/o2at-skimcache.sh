@@ -0,0 +1,80 @@
+#!/usr/bin/env bash
+# Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+# See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+# All rights not expressly granted are reserved.
+#
+# This software is distributed under the terms of the GNU General Public
+# License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+#
+# In applying this license CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization
+# or submit itself to any jurisdiction.
+#
+# Local cache of the derived table of o2at-skimming.cxx, to iterate quickly on
+# ReadDerivedTable. The first run produces aod::MyTable from the input and
+# stores it uncompressed in the cache directory. It is keyed by the input
+# files (name, size, modification time) and by the configuration of the
+# producer. Later runs with the same key only run ReadDerivedTable on the
+# cached file, so they skip the HF helper workflows and the decompression.
+#
+# Usage: ./o2at-skimcache.sh AO2D.root|@input_files.txt [config.json] [-- options of ReadDerivedTable]
+
+set -eu
+
+INPUT=${1:?"usage: $0 AO2D.root|@input_files.txt [config.json] [-- options]"}
+shift
+CONFIG=""
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+  CONFIG=$1
+  shift
+fi
+[ $# -gt 0 ] && [ "$1" == "--" ] && shift
+
+WORKFLOW=${O2AT_SKIMMING:-o2-analysistutorial-o2at-skimming}
+CACHE=${O2AT_SKIM_CACHE:-${HOME}/.cache/o2at-skim}
+# options as a string for the pipelines run through bash -c (paths quoted with
+# %q) and as an array for the reading workflow run directly
+ARGS="-b"
+READ_ARGS=(-b)
+if [ -n "${CONFIG}" ]; then
+  ARGS="${ARGS} --configuration $(printf "%q" "json://${CONFIG}")"
+  READ_ARGS+=(--configuration "json://${CONFIG}")
+fi
+
+# helper workflows providing HfCandProng2 (adapt to your O2Physics installation)
+HF=${O2AT_HF_HELPERS:-"o2-analysis-track-propagation ${ARGS} | o2-analysis-hf-track-index-skim-creator ${ARGS} | o2-analysis-hf-candidate-creator-2prong ${ARGS}"}
+
+# cache key: input files and producer configuration. Local files are keyed by
+# name, size and modification time, remote ones (root://, alien://, ...) by
+# their name only; a local file that cannot be found is an error
+if [ "${INPUT:0:1}" == "@" ]; then
+  mapfile -t FILES < <(grep -v '^[[:space:]]*$' "${INPUT:1}")
+else
+  FILES=("${INPUT}")
+fi
+KEYDATA=""
+for FILE in "${FILES[@]}"; do
+  if [[ "${FILE}" == *://* ]]; then
+    KEYDATA+="${FILE}"$'\n'
+  else
+    FILESTAT=$(stat -c "%n %s %Y" -- "${FILE}") || { echo "Cannot stat the input file ${FILE}" >&2; exit 1; }
+    KEYDATA+="${FILESTAT}"$'\n'
+  fi
+done
+if [ -n "${CONFIG}" ]; then
+  KEYDATA+=$(cat -- "${CONFIG}")
+fi
+KEY=$(printf "%s" "${KEYDATA}" | sha1sum | cut -c1-16)
+SKIM=${CACHE}/AO2D_skim_${KEY}
+
+mkdir -p "${CACHE}"
+if [ ! -f "${SKIM}.root" ]; then
+  echo "Producing the derived table into ${SKIM}.root"
+  # no compression: the cache is read many times, from a local disk
+  bash -c "${HF} | ${WORKFLOW} ${ARGS} --aod-file $(printf "%q" "${INPUT}") \
+    --aod-writer-keep AOD/MYTABLE/0 --aod-writer-resfile $(printf "%q" "${SKIM}.tmp") --aod-writer-compression 0"
+  mv -f "${SKIM}.tmp.root" "${SKIM}.root"
+fi
+
+echo "Reading the derived table from ${SKIM}.root"
+"${WORKFLOW}" "${READ_ARGS[@]}" --readDerived --aod-file "${SKIM}.root" "$@"
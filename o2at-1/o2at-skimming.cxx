@@ -16,60 +16,193 @@
 /// \author
 /// \since
 
-#include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Framework/HistogramRegistry.h"
+#include "Framework/CallbackService.h"
+#include "Framework/EndOfStreamContext.h"
 #include "PWGHF/DataModel/HFSecondaryVertex.h"
 #include "PWGHF/DataModel/HFCandidateSelectionTables.h"
+#include "o2at-checkpoint.h"
+#include "o2at-twoprongmass.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
 
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
 
+// the fused mode (STEP 6) replaces the tasks of steps 2 to 5 with a single one,
+// the readDerived mode runs STEP 5 alone on a derived table (e.g. on a local
+// copy of the skim): the options are read when the workflow is built, hence
+// customize() has to be defined before including runDataProcessing.h
+void customize(std::vector<ConfigParamSpec>& workflowOptions)
+{
+  workflowOptions.push_back(ConfigParamSpec{"fused", VariantType::Bool, false, {"Run steps 2 to 5 in a single task"}});
+  workflowOptions.push_back(ConfigParamSpec{"readDerived", VariantType::Bool, false, {"Run only ReadDerivedTable, on an existing derived table"}});
+}
+
+#include "Framework/runDataProcessing.h"
+
 // STEP 1
 //<- starting point, define the derived table to be stored
 // this can be done in a separated header file, but for semplicity we do it in
 // the same file here
 
+// to reduce the size of the derived data, the float quantities are stored as
+// 16-bit fixed-point numbers in a declared range, and decoded on read by dynamic
+// columns which keep the original getters (invMassD0(), pt(), ...)
 namespace o2::aod
 {
 namespace mytable
 {
-DECLARE_SOA_COLUMN(InvMassD0, invMassD0, float);           //!
-DECLARE_SOA_COLUMN(InvMassD0bar, invMassD0bar, float);     //!
-DECLARE_SOA_COLUMN(Pt, pt, float);                         //!
-DECLARE_SOA_COLUMN(CosinePointing, cosinePointing, float); //!
-DECLARE_SOA_INDEX_COLUMN(Collision, collision);            //!
+// codes 1..65534 split [min, max] into equal intervals and are decoded to the
+// interval centres, so that the last code stays strictly below max; 0 and 65535
+// flag values below and above the range, which are decoded half an interval
+// outside of it (i.e. to underflow and overflow); a NaN is flagged as above the
+// range, as the float to integer conversion of a NaN is undefined
+constexpr uint16_t encodeFixed16(float value, float min, float max)
+{
+  if (value < min) {
+    return 0;
+  }
+  if (!(value <= max)) { //<- also true for a NaN
+    return 65535;
+  }
+  const auto lInterval = static_cast<uint16_t>((value - min) / (max - min) * 65534.f); //<- value >= min: truncation is floor
+  return 1 + (lInterval < 65533 ? lInterval : 65533); //<- value == max goes to the last interval
+}
+constexpr float decodeFixed16(uint16_t code, float min, float max)
+{
+  return min + (static_cast<float>(code) - 0.5f) * (max - min) / 65534.f;
+}
+
+// declared ranges: mass resolution 15 keV, pt resolution 1.5 MeV, cos(theta_P) resolution 3e-6
+constexpr float massMin = 1.5f;
+constexpr float massMax = 2.5f;
+constexpr float ptMin = 0.f;
+constexpr float ptMax = 100.f;
+constexpr float cosinePointingMin = 0.8f;
+constexpr float cosinePointingMax = 1.f;
+
+// round trip of the edges of a histogram (nBins in [histMin, histMax]) within
+// the declared range [min, max]: each edge comes back within half an interval,
+// and the ends of the declared range stay inside it
+constexpr bool roundTripsOverEdges(int nBins, double histMin, double histMax, float min, float max)
+{
+  const double lHalfInterval = 0.5 * (double(max) - double(min)) / 65534.;
+  for (int iEdge = 0; iEdge <= nBins; iEdge++) {
+    const float lEdge = static_cast<float>(histMin + iEdge * (histMax - histMin) / nBins);
+    const double lDecoded = decodeFixed16(encodeFixed16(lEdge, min, max), min, max);
+    const double lDistance = lDecoded > lEdge ? lDecoded - lEdge : lEdge - lDecoded;
+    if (lDistance > 1.1 * lHalfInterval) { //<- with some margin for the float rounding
+      return false;
+    }
+    if ((lEdge == min && lDecoded < min) || (lEdge == max && lDecoded >= max)) {
+      return false;
+    }
+  }
+  return true;
+}
+// the histograms of ReadDerivedTable
+static_assert(roundTripsOverEdges(300, 1.75, 2.05, massMin, massMax));
+static_assert(roundTripsOverEdges(50, 0., 50., ptMin, ptMax));
+static_assert(roundTripsOverEdges(100, 0.8, 1., cosinePointingMin, cosinePointingMax));
+static_assert(roundTripsOverEdges(1, massMin, massMax, massMin, massMax) &&
+              roundTripsOverEdges(1, ptMin, ptMax, ptMin, ptMax) &&
+              roundTripsOverEdges(1, cosinePointingMin, cosinePointingMax, cosinePointingMin, cosinePointingMax));
+static_assert(encodeFixed16(std::numeric_limits<float>::quiet_NaN(), cosinePointingMin, cosinePointingMax) == 65535);
+
+DECLARE_SOA_COLUMN(InvMassD0Code, invMassD0Code, uint16_t);           //!
+DECLARE_SOA_COLUMN(InvMassD0barCode, invMassD0barCode, uint16_t);     //!
+DECLARE_SOA_COLUMN(PtCode, ptCode, uint16_t);                         //!
+DECLARE_SOA_COLUMN(CosinePointingCode, cosinePointingCode, uint16_t); //!
+DECLARE_SOA_INDEX_COLUMN(Collision, collision);                       //!
+
+DECLARE_SOA_DYNAMIC_COLUMN(InvMassD0, invMassD0, //!
+                           [](uint16_t code) -> float { return decodeFixed16(code, massMin, massMax); });
+DECLARE_SOA_DYNAMIC_COLUMN(InvMassD0bar, invMassD0bar, //!
+                           [](uint16_t code) -> float { return decodeFixed16(code, massMin, massMax); });
+DECLARE_SOA_DYNAMIC_COLUMN(Pt, pt, //!
+                           [](uint16_t code) -> float { return decodeFixed16(code, ptMin, ptMax); });
+DECLARE_SOA_DYNAMIC_COLUMN(CosinePointing, cosinePointing, //!
+                           [](uint16_t code) -> float { return decodeFixed16(code, cosinePointingMin, cosinePointingMax); });
 } // namespace mytable
 
 DECLARE_SOA_TABLE(MyTable, "AOD", "MYTABLE", //!
-                  mytable::InvMassD0,
-                  mytable::InvMassD0bar,
-                  mytable::Pt,
-                  mytable::CosinePointing,
-                  mytable::CollisionId)
+                  mytable::InvMassD0Code,
+                  mytable::InvMassD0barCode,
+                  mytable::PtCode,
+                  mytable::CosinePointingCode,
+                  mytable::CollisionId,
+                  mytable::InvMassD0<mytable::InvMassD0Code>,
+                  mytable::InvMassD0bar<mytable::InvMassD0barCode>,
+                  mytable::Pt<mytable::PtCode>,
+                  mytable::CosinePointing<mytable::CosinePointingCode>)
 
 } // namespace o2::aod
 
+// invariant masses of all the candidates of a time frame at once, in the order
+// of the candidates: mass[i] for D0 -> pi+ K- (prong 0 is the pion, as in
+// InvMassD0) and massSwapped[i] for D0bar (prong masses swapped)
+struct D0Masses : o2at::TwoProngMasses {
+  template <typename TCandidates>
+  void compute(TCandidates const& cand2Prongs)
+  {
+    o2at::TwoProngMasses::compute(cand2Prongs, RecoDecay::getMassPDG(kPiPlus), RecoDecay::getMassPDG(kKPlus));
+  }
+};
+
+// selection of the candidates tagged as D0 -> pi K, to be used in the Filters
+inline expressions::Node d0Tag()
+{
+  return (aod::hf_track_index::hfflag & static_cast<uint8_t>(BIT(aod::hf_cand_prong2::DecayType::D0ToPiK))) != static_cast<uint8_t>(0);
+}
+
+// codes of a row of aod::MyTable (see STEP 1)
+struct MyTableCodes {
+  uint16_t invMassD0;
+  uint16_t invMassD0bar;
+  uint16_t pt;
+  uint16_t cosinePointing;
+};
+
+// encodes a candidate and stores it in the derived table, with the collision
+// index retrieved from one of the daughters; returns the stored codes
+template <typename TTable, typename TCandidate>
+MyTableCodes fillMyTable(TTable& table, TCandidate const& cand, double invMassD0, double invMassD0bar)
+{
+  using namespace aod::mytable;
+  const MyTableCodes codes{encodeFixed16(invMassD0, massMin, massMax),
+                           encodeFixed16(invMassD0bar, massMin, massMax),
+                           encodeFixed16(cand.pt(), ptMin, ptMax),
+                           encodeFixed16(cand.cpa(), cosinePointingMin, cosinePointingMax)};
+  auto dauTrack = cand.template index0_as<aod::Tracks>(); // positive daughter
+  table(codes.invMassD0, codes.invMassD0bar, codes.pt, codes.cosinePointing, dauTrack.collisionId());
+  return codes;
+}
+
 // STEP 2
 struct ReadHFCandidates { //<- simple workflow that loops over HF 2-prong
                           // candidates
 
-  void process(aod::HfCandProng2 const& cand2Prongs)
-  {
+  D0Masses masses;
 
-    // loop over HF 2-prong candidates
-    for (auto& cand : cand2Prongs) {
+  // select the candidates tagged as D0 in the Filter, instead of skipping the others in the loop
+  Filter d0Filter = d0Tag();
 
-      // check first if the HF 2-prong candidate is tagged as a D0
-      bool isD0Sel = TESTBIT(cand.hfflag(), aod::hf_cand_prong2::DecayType::D0ToPiK);
+  void process(soa::Filtered<aod::HfCandProng2> const& cand2Prongs)
+  {
 
-      if (!isD0Sel) {
-        continue;
-      }
+    masses.compute(cand2Prongs);
+    size_t iCand = 0;
 
-      auto invMassD0 = InvMassD0(cand);
-      auto invMassD0bar = InvMassD0bar(cand);
+    // loop over HF 2-prong candidates
+    for (auto& cand : cand2Prongs) {
+      auto invMassD0 = masses.mass[iCand];
+      auto invMassD0bar = masses.massSwapped[iCand];
+      iCand++;
 
       LOG(debug) << "Candidate with mass(D0) = " << invMassD0
                  << ", mass(D0bar) = " << invMassD0bar
@@ -85,31 +218,31 @@ struct ProduceDerivedTable { //<- workflow that loops over HF 2-prong
 
   Produces<aod::MyTable> tableWithDzeroCandidates;
 
-  void process(aod::HfCandProng2 const& cand2Prongs, aod::Tracks const&)
-  {
+  D0Masses masses;
 
-    // loop over 2-prong candidates
-    for (auto& cand : cand2Prongs) {
+  // select the candidates tagged as D0 in the Filter, instead of skipping the others in the loop
+  Filter d0Filter = d0Tag();
 
-      // check first if the HF 2-prong candidate is tagged as a D0
-      bool isD0Sel = TESTBIT(cand.hfflag(), aod::hf_cand_prong2::DecayType::D0ToPiK);
+  void process(soa::Filtered<aod::HfCandProng2> const& cand2Prongs, aod::Tracks const&)
+  {
+    // pre-size the table builder: at most one row per candidate
+    tableWithDzeroCandidates.reserve(cand2Prongs.size());
 
-      if (!isD0Sel) {
-        continue;
-      }
+    masses.compute(cand2Prongs);
+    size_t iCand = 0;
 
-      auto invMassD0 = InvMassD0(cand);
-      auto invMassD0bar = InvMassD0bar(cand);
+    // loop over 2-prong candidates
+    for (auto& cand : cand2Prongs) {
+      auto invMassD0 = masses.mass[iCand];
+      auto invMassD0bar = masses.massSwapped[iCand];
+      iCand++;
 
       LOG(debug) << "Candidate with mass(D0) = " << invMassD0
                  << ", mass(D0bar) = " << invMassD0bar
                  << ", pt = " << cand.pt()
                  << ", cos(theta_P) = " << cand.cpa();
 
-      // we retrieve also the event index from one of the daughters
-      auto dauTrack = cand.index0_as<aod::Tracks>(); // positive daughter
-
-      tableWithDzeroCandidates(invMassD0, invMassD0bar, cand.pt(), cand.cpa(), dauTrack.collisionId());
+      fillMyTable(tableWithDzeroCandidates, cand, invMassD0, invMassD0bar);
     }
   }
 };
@@ -119,32 +252,32 @@ struct ProduceDerivedTableFilter { //<- workflow that loops over HF 2-prong
                                    // candidates and fills a derived table after applying a filter on pt
 
   Produces<aod::MyTable> tableWithDzeroCandidates;
-  Filter ptFilter = std::sqrt(aod::hf_cand_prong2::px * aod::hf_cand_prong2::px + aod::hf_cand_prong2::py * aod::hf_cand_prong2::py) > 4.;
+
+  D0Masses masses;
+  // D0 tag and pt > 4 GeV/c in a single expression (pt^2 > 16, to avoid a sqrt per row)
+  Filter d0PtFilter = d0Tag() &&
+                      aod::hf_cand_prong2::px * aod::hf_cand_prong2::px + aod::hf_cand_prong2::py * aod::hf_cand_prong2::py > 16.f;
 
   void process(soa::Filtered<aod::HfCandProng2> const& cand2Prongs, aod::Tracks const&)
   {
-    // loop over 2-prong candidates
-    for (auto& cand : cand2Prongs) {
-
-      // check first if the HF 2-prong candidate is tagged as a D0
-      bool isD0Sel = TESTBIT(cand.hfflag(), aod::hf_cand_prong2::DecayType::D0ToPiK);
+    // pre-size the table builder: at most one row per candidate
+    tableWithDzeroCandidates.reserve(cand2Prongs.size());
 
-      if (!isD0Sel) {
-        continue;
-      }
+    masses.compute(cand2Prongs);
+    size_t iCand = 0;
 
-      auto invMassD0 = InvMassD0(cand);
-      auto invMassD0bar = InvMassD0bar(cand);
+    // loop over 2-prong candidates
+    for (auto& cand : cand2Prongs) {
+      auto invMassD0 = masses.mass[iCand];
+      auto invMassD0bar = masses.massSwapped[iCand];
+      iCand++;
 
       LOG(debug) << "Candidate with mass(D0) = " << invMassD0
                  << ", mass(D0bar) = " << invMassD0bar
                  << ", pt = " << cand.pt()
                  << ", cos(theta_P) = " << cand.cpa();
 
-      // we retrieve also the collision index from one of the daughters
-      auto dauTrack = cand.index0_as<aod::Tracks>(); // positive daughter
-
-      tableWithDzeroCandidates(invMassD0, invMassD0bar, cand.pt(), cand.cpa(), dauTrack.collisionId());
+      fillMyTable(tableWithDzeroCandidates, cand, invMassD0, invMassD0bar);
     }
   }
 };
@@ -159,8 +292,44 @@ struct ReadDerivedTable { //<- workflow that reads derived table and fill
                               {"hPt", ";#it{p}_{T} (GeV/#it{c});counts", {HistType::kTH1F, {{50, 0., 50.}}}},
                               {"hCosp", ";cos(#vartheta_{P}) ;counts", {HistType::kTH1F, {{100, 0.8, 1.}}}}}};
 
-  void process(aod::MyTable const& cand2Prongs)
+  // periodic snapshots of the histograms, to resume an interrupted job on the
+  // same input (disabled if no file is given); the snapshot is removed at the
+  // end of a complete job
+  Configurable<std::string> checkpointFile{"checkpointFile", "", "File of the histogram snapshots (empty: disabled)"};
+  Configurable<int> checkpointPeriod{"checkpointPeriod", 100, "Number of time frames between two snapshots"};
+  o2at::Checkpoint checkpoint;
+
+  void init(InitContext& context)
+  {
+    checkpoint.add(registry.get<TH1>(HIST("hMassD0")));
+    checkpoint.add(registry.get<TH1>(HIST("hMassD0bar")));
+    checkpoint.add(registry.get<TH1>(HIST("hPt")));
+    checkpoint.add(registry.get<TH1>(HIST("hCosp")));
+    checkpoint.setup(checkpointFile.value, checkpointPeriod.value);
+    context.services().get<CallbackService>().set<CallbackService::Id::EndOfStream>([this](EndOfStreamContext&) {
+      checkpoint.endOfStream();
+      if (checkpoint.inputChanged()) {
+        LOG(fatal) << "The input has fewer time frames than the snapshot " << checkpointFile.value;
+      }
+    });
+  }
+
+  void process(aod::MyTable const& cand2Prongs) //<- called once per time frame
   {
+    // the time frame is identified by its number of candidates and the codes of
+    // the first one
+    uint64_t timeFrameKey = cand2Prongs.size();
+    if (cand2Prongs.size() > 0) {
+      auto first = cand2Prongs.begin();
+      timeFrameKey = (timeFrameKey << 32) ^ (static_cast<uint64_t>(first.ptCode()) << 16) ^ first.invMassD0Code();
+    }
+    const bool skip = checkpoint.skipTimeFrame(timeFrameKey);
+    if (checkpoint.inputChanged()) {
+      LOG(fatal) << "The input differs from the one of the snapshot " << checkpointFile.value << ": remove it to start from scratch";
+    }
+    if (skip) {
+      return; // already in the resumed snapshot
+    }
 
     // loop over 2-prong candidates
     for (auto& cand : cand2Prongs) {
@@ -169,14 +338,78 @@ struct ReadDerivedTable { //<- workflow that reads derived table and fill
       registry.fill(HIST("hPt"), cand.pt());
       registry.fill(HIST("hCosp"), cand.cosinePointing());
     }
+    checkpoint.endTimeFrame();
   }
 };
 
+// STEP 6
+struct FusedHFCandidates { //<- the work of steps 2 to 5 in a single device and
+                           // a single loop over the candidates
+
+  Produces<aod::MyTable> tableWithDzeroCandidates;
+
+  D0Masses masses;
+
+  Configurable<float> ptCandMin{"ptCandMin", 0., "Minimum pt of the stored candidates (4 as in step 4)"};
+
+  // D0 tag and pt selection in a single expression (pt^2 as in step 4, no square root per row)
+  Filter d0PtFilter = d0Tag() &&
+                      aod::hf_cand_prong2::px * aod::hf_cand_prong2::px + aod::hf_cand_prong2::py * aod::hf_cand_prong2::py > ptCandMin * ptCandMin;
+
+  // same histograms as ReadDerivedTable
+  HistogramRegistry registry{"registry",
+                             {{"hMassD0", ";#it{M}(K#pi) (GeV/#it{c}^{2});counts", {HistType::kTH1F, {{300, 1.75, 2.05}}}},
+                              {"hMassD0bar", ";#it{M}(#piK) (GeV/#it{c}^{2});counts", {HistType::kTH1F, {{300, 1.75, 2.05}}}},
+                              {"hPt", ";#it{p}_{T} (GeV/#it{c});counts", {HistType::kTH1F, {{50, 0., 50.}}}},
+                              {"hCosp", ";cos(#vartheta_{P}) ;counts", {HistType::kTH1F, {{100, 0.8, 1.}}}}}};
+
+  void process(soa::Filtered<aod::HfCandProng2> const& cand2Prongs, aod::Tracks const&)
+  {
+    // pre-size the table builder: at most one row per candidate
+    tableWithDzeroCandidates.reserve(cand2Prongs.size());
+
+    masses.compute(cand2Prongs);
+    size_t iCand = 0;
+
+    // loop over 2-prong candidates
+    for (auto& cand : cand2Prongs) {
+      auto invMassD0 = masses.mass[iCand];
+      auto invMassD0bar = masses.massSwapped[iCand];
+      iCand++;
+
+      LOG(debug) << "Candidate with mass(D0) = " << invMassD0
+                 << ", mass(D0bar) = " << invMassD0bar
+                 << ", pt = " << cand.pt()
+                 << ", cos(theta_P) = " << cand.cpa();
+
+      auto codes = fillMyTable(tableWithDzeroCandidates, cand, invMassD0, invMassD0bar);
+
+      // the histograms are filled with the stored (decoded) values, i.e. exactly
+      // what ReadDerivedTable reads back from the derived table
+      registry.fill(HIST("hMassD0"), aod::mytable::decodeFixed16(codes.invMassD0, aod::mytable::massMin, aod::mytable::massMax));
+      registry.fill(HIST("hMassD0bar"), aod::mytable::decodeFixed16(codes.invMassD0bar, aod::mytable::massMin, aod::mytable::massMax));
+      registry.fill(HIST("hPt"), aod::mytable::decodeFixed16(codes.pt, aod::mytable::ptMin, aod::mytable::ptMax));
+      registry.fill(HIST("hCosp"), aod::mytable::decodeFixed16(codes.cosinePointing, aod::mytable::cosinePointingMin, aod::mytable::cosinePointingMax));
+    }
+  }
+};
+
+// N.B.: every adaptAnalysisTask is a separate device, with its own copy of the
+// histograms and of the state needed to iterate over its inputs: add each task
+// only once, otherwise the same work (and memory) is paid twice
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
 {
+  if (cfgc.options().get<bool>("fused") && cfgc.options().get<bool>("readDerived")) {
+    LOG(fatal) << "The fused and readDerived options are exclusive: the fused task reads the HF candidates, not a derived table";
+  }
+  if (cfgc.options().get<bool>("fused")) {
+    return WorkflowSpec{adaptAnalysisTask<FusedHFCandidates>(cfgc)};
+  }
+  if (cfgc.options().get<bool>("readDerived")) {
+    return WorkflowSpec{adaptAnalysisTask<ReadDerivedTable>(cfgc)};
+  }
   return WorkflowSpec{adaptAnalysisTask<ReadHFCandidates>(cfgc),
                       adaptAnalysisTask<ProduceDerivedTable>(cfgc),
                       adaptAnalysisTask<ProduceDerivedTableFilter>(cfgc),
-                      adaptAnalysisTask<ReadDerivedTable>(cfgc),
                       adaptAnalysisTask<ReadDerivedTable>(cfgc)};
 }
@@ -0,0 +1,79 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \brief Batched filling of HistogramRegistry histograms.
+///        The histogram handle is resolved once (e.g. in init()), values are
+///        pushed into a staging buffer inside the track loop and added to the
+///        histogram with a single FillN call, e.g. at the end of the collision.
+/// \author
+/// \since
+
+#ifndef O2AT_STAGEDFILL_H_
+#define O2AT_STAGEDFILL_H_
+
+#include <memory>
+#include <vector>
+
+#include <TH1.h>
+#include <TH2.h>
+
+namespace o2at
+{
+
+//Staged filling of a one-dimensional histogram
+class StagedFill1D
+{
+ public:
+  void bind(std::shared_ptr<TH1> histogram) { mHistogram = histogram; }
+  void push(double x) { mX.push_back(x); }
+  void flush()
+  {
+    if (mX.empty()) {
+      return;
+    }
+    mHistogram->FillN(mX.size(), mX.data(), nullptr); //<- unit weights
+    mX.clear();
+  }
+
+ private:
+  std::shared_ptr<TH1> mHistogram;
+  std::vector<double> mX;
+};
+
+//Staged filling of a two-dimensional histogram
+class StagedFill2D
+{
+ public:
+  void bind(std::shared_ptr<TH2> histogram) { mHistogram = histogram; }
+  void push(double x, double y)
+  {
+    mX.push_back(x);
+    mY.push_back(y);
+  }
+  void flush()
+  {
+    if (mX.empty()) {
+      return;
+    }
+    mHistogram->FillN(mX.size(), mX.data(), mY.data(), nullptr); //<- unit weights
+    mX.clear();
+    mY.clear();
+  }
+
+ private:
+  std::shared_ptr<TH2> mHistogram;
+  std::vector<double> mX;
+  std::vector<double> mY;
+};
+
+} // namespace o2at
+
+#endif // O2AT_STAGEDFILL_H_
@@ -0,0 +1,62 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \brief Gather of the V0 daughter information used by the V0 examples.
+///        The daughter tracks of all the V0s of a collision are dereferenced
+///        once, and only the columns that are needed (the TPC n-sigmas) are
+///        copied into contiguous buffers, which the V0 loop then reads linearly.
+/// \author
+/// \since
+
+#ifndef O2AT_V0DAUGHTERS_H_
+#define O2AT_V0DAUGHTERS_H_
+
+#include <cmath>
+#include <vector>
+
+namespace o2at
+{
+
+//Absolute TPC n-sigmas of the daughters, one entry per V0 in table order
+struct V0DaughterPID {
+  std::vector<float> posNSigmaPr;
+  std::vector<float> posNSigmaPi;
+  std::vector<float> negNSigmaPr;
+  std::vector<float> negNSigmaPi;
+
+  void clear()
+  {
+    posNSigmaPr.clear();
+    posNSigmaPi.clear();
+    negNSigmaPr.clear();
+    negNSigmaPi.clear();
+  }
+  size_t size() const { return posNSigmaPr.size(); }
+
+  //TMyTracks is the track type that carries the PID columns (Run 2 or Run 3 Join)
+  template <class TMyTracks, typename TV0s>
+  void gather(TV0s const& V0s)
+  {
+    clear();
+    for (auto& v0 : V0s) {
+      auto posTrack = v0.template posTrack_as<TMyTracks>();
+      auto negTrack = v0.template negTrack_as<TMyTracks>();
+      posNSigmaPr.push_back(std::abs(posTrack.tpcNSigmaPr()));
+      posNSigmaPi.push_back(std::abs(posTrack.tpcNSigmaPi()));
+      negNSigmaPr.push_back(std::abs(negTrack.tpcNSigmaPr()));
+      negNSigmaPi.push_back(std::abs(negTrack.tpcNSigmaPi()));
+    }
+  }
+};
+
+} // namespace o2at
+
+#endif // O2AT_V0DAUGHTERS_H_